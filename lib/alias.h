@@ -1,3 +1,6 @@
+#ifndef ALIAS_H
+#define ALIAS_H
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -7,4 +10,8 @@
 #define MAX_ALIASES 512
 
 int create_alias(char *alias_name, char *alias_command);
-int handle_alias_command(char **tokens, int tokenCount);
\ No newline at end of file
+int handle_alias_command(char **tokens, int tokenCount);
+void get_alias(const char *alias_name, char *buffer, size_t buffer_size);
+void replace_alias_in_command(char *input, char *output, size_t max_output_length);
+
+#endif
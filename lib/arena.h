@@ -0,0 +1,33 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+#define ARENA_BLOCK_SIZE 4096
+
+typedef struct arena_block {
+    struct arena_block *next;
+    size_t used;
+    size_t size;
+    char data[];
+} arena_block;
+
+typedef struct arena {
+    arena_block *head;
+} arena;
+
+/* A byte buffer that grows inside an arena. Outgrown storage is reclaimed
+ * when the arena is freed. */
+typedef struct arena_buffer {
+    char *data;
+    size_t length;
+    size_t capacity;
+} arena_buffer;
+
+void *arena_alloc(arena *a, size_t size);
+char *arena_strndup(arena *a, const char *s, size_t length);
+char *arena_strdup(arena *a, const char *s);
+char *arena_buffer_reserve(arena *a, arena_buffer *buffer, size_t size);
+void arena_free(arena *a);
+
+#endif
@@ -0,0 +1,15 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include "command.h"
+
+#define DEFAULT_BENCH_RUNS 10
+#define DEFAULT_BENCH_WARMUP 1
+#define MAX_BENCH_RUNS 100000
+#define MAX_BENCH_COMMANDS 16
+#define OUTLIER_FENCE 1.5 // Runs further than this many IQRs outside the quartiles are rejected
+#define MIN_OUTLIER_RUNS 5 // Fewer runs are all kept
+
+int handle_bench_command(command *cmd);
+
+#endif
@@ -1,8 +1,19 @@
+#ifndef COMMAND_H
+#define COMMAND_H
+
 #define MAX_ARGUMENTS 256
+#define MAX_TEE_TARGETS 16
+#define MAX_PINNED_CPUS 1024
 
 typedef enum operation { NO_OP,
                          EXIT,
                          ALIAS,
+                         SOURCE,
+                         JOBS,
+                         FILTERS,
+                         WATCH,
+                         BENCH,
+                         INVALID,
                          OTHER } operation;
 
 typedef enum redirect { NO_REDIRECT,
@@ -10,13 +21,58 @@ typedef enum redirect { NO_REDIRECT,
                         APPEND,
                         REVERSE } redirect;
 
+typedef enum input_redirect { NO_INPUT,
+                              INPUT_FILE,     // < file
+                              HERE_STRING,    // <<< text
+                              HERE_DOCUMENT } input_redirect; // <<DELIMITER
+
+/* How a command of a chain depends on the exit status of the one before */
+typedef enum connector { CHAIN_ALWAYS, // ';' or the first command
+                         CHAIN_AND,    // '&&', runs after a success
+                         CHAIN_OR } connector; // '||', runs after a failure
+
+/* One command of 'a && b || c ; d': a range of tokens */
+typedef struct chain_link {
+    int start;
+    int count;
+    connector connector;
+} chain_link;
+
+/* Settings applied to a child process by prefix builtins such as
+ * 'timeout SECS cmd'. Zero means the default for every field. */
+typedef struct launch_options {
+    double timeout;                          // Seconds until the command is stopped
+    int pinned;                              // 'pin LIST': run only on the CPUs in cpus
+    unsigned char cpus[MAX_PINNED_CPUS / 8]; // Bitmap, CPU n is bit n % 8 of byte n / 8
+    int niced;                               // 'nice N': change the priority by nice
+    int nice;
+    long long memory_limit; // 'limit mem=SIZE': bytes of address space
+    long long cpu_limit;    // 'limit cpu=SECS': seconds of CPU time
+    long long file_limit;   // 'limit files=N': open file descriptors
+    int perfstat;           // 'perfstat': count hardware and software events
+} launch_options;
+
 typedef struct command {
     operation op;
     char *arguments[MAX_ARGUMENTS];
     int num_arguments;
     int background;
     redirect redirect;
+    char *output_file;
+    char *tee_files[MAX_TEE_TARGETS]; // Targets of '>|', all get the output
+    int num_tee_files;
+    input_redirect input;
+    char *input_source; // File of '<', text of '<<<', delimiter of '<<'
+    char *document;     // Body of a '<<' here document, read by the caller
+    launch_options launch;
 } command;
 
+extern const char *builtin_names[];
+
 command parse_command(char *tokens[], int tokenCount);
-void print_command(command cmd);
\ No newline at end of file
+int is_chain_operator(const char *token);
+int split_chain(char *tokens[], const int quoted[], int tokenCount, chain_link links[], const char **error);
+int link_runs(connector connector, int status);
+void print_command(command cmd);
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef COMPLETION_H
+#define COMPLETION_H
+
+#include "tokenize.h"
+
+#define MAX_PATH_DIRECTORIES 128
+#define MAX_LISTED_COMPLETIONS 100
+
+typedef struct completion_result {
+    int count;                                // Number of matching commands
+    char common[MAX_INPUT_LENGTH];            // Longest common prefix of all matches
+    char *listed[MAX_LISTED_COMPLETIONS];     // The first matches, allocated
+    int num_listed;
+} completion_result;
+
+void start_completion_index(void);
+void refresh_completion_index(void);
+int complete_command(const char *prefix, completion_result *result);
+void free_completion_result(completion_result *result);
+
+#endif
@@ -0,0 +1,27 @@
+#ifndef DIRSCAN_H
+#define DIRSCAN_H
+
+#include <dirent.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#include "arena.h"
+
+#define DIRSCAN_BUFFER_SIZE 65536
+
+/* The entries of one directory. Names point into buffers owned by the
+ * listing's arena; types are DT_* values (DT_UNKNOWN if the file system does
+ * not report them). */
+typedef struct directory_listing {
+    char **names;
+    unsigned char *types;
+    int count;
+    int capacity;
+    arena strings;
+} directory_listing;
+
+int list_directory(int dirfd, directory_listing *listing);
+void free_directory_listing(directory_listing *listing);
+struct timespec stat_mtime(const struct stat *st);
+
+#endif
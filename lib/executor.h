@@ -0,0 +1,16 @@
+#ifndef EXECUTOR_H
+#define EXECUTOR_H
+
+#include "command.h"
+#include "jobs.h"
+
+#define MAX_PATH_LENGTH 512
+#define MAX_PIPELINE_STAGES 16
+
+char *find_executable(char *command);
+int spawn_command(command *cmd, const char *executable_path, const int stdio[2], job **started);
+int execute_command(command *cmd, const char *executable_path);
+int run_command(command *cmd, const char *executable_path);
+int run_line(char *line, char *document);
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef FILTERS_H
+#define FILTERS_H
+
+#include <stddef.h>
+
+#include "command.h"
+
+#define FILTER_BUFFER_SIZE 131072
+#define MAX_TRANSLATE_SET 1024
+
+typedef enum filter_kind { COUNT_LINES, // wc -l
+                           HEAD_LINES,  // head -n N
+                           GREP_FIXED,  // grep -F PATTERN
+                           TRANSLATE } filter_kind; // tr SET1 SET2, tr -d SET1
+
+/* A command the shell can run in-process instead of forking coreutils */
+typedef struct filter {
+    filter_kind kind;
+    const command *cmd;      // The stage, for its input and redirections
+    const char *file;        // File operand, NULL to read the input
+    long long limit;         // Lines head prints
+    const char *pattern;     // Fixed string grep looks for
+    size_t pattern_length;
+    unsigned char map[256];  // tr: replacement of every byte
+    unsigned char drop[256]; // tr -d: 1 for bytes that are deleted
+    int delete;
+
+    // State while the filter runs
+    long long lines;
+    int matched;
+    int binary;    // grep: a NUL byte was seen, matching lines are not printed
+    char *partial; // grep: the incomplete last line seen so far
+    size_t partial_length;
+    size_t partial_capacity;
+} filter;
+
+void set_builtin_filters(int enabled);
+int builtin_filters_enabled(void);
+int compile_filter(const command *cmd, filter *f, int last);
+int run_filters(filter filters[], int count, int input_fd);
+int handle_filters_command(char **arguments, int num_arguments);
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef JOBS_H
+#define JOBS_H
+
+#include <stddef.h>
+#include <sys/resource.h>
+#include <sys/types.h>
+
+#include "command.h"
+#include "redirect.h"
+
+#define MAX_JOBS 64
+#define RING_BUFFER_SIZE 65536
+#define MAX_JOB_TEXT 256
+#define TIMEOUT_GRACE_SECONDS 1
+
+/* The last RING_BUFFER_SIZE bytes written to one output stream of a job */
+typedef struct ring_buffer {
+    char data[RING_BUFFER_SIZE];
+    size_t head;    // Total number of bytes ever written
+    int fd;         // Read end of the pipe, -1 once closed
+} ring_buffer;
+
+typedef enum job_state { JOB_FREE,
+                         JOB_RUNNING,
+                         JOB_DONE } job_state;
+
+/* A child process watched by the supervisor */
+typedef struct job {
+    int id;
+    job_state state;
+    pid_t pid;
+    int pidfd;    // -1 if the kernel has no pidfd_open
+    int timerfd;  // -1 without a timeout
+    int background;
+    int reported; // The shell told the user the job finished
+    int timed_out;
+    int status;   // Exit status once done
+    struct rusage usage;    // Resources used, once done
+    char text[MAX_JOB_TEXT];
+    ring_buffer *output[2]; // Captured stdout and stderr, or NULL
+    tee_relay *tee;         // Copies stdout to the '>|' targets until EOF
+} job;
+
+void set_output_capture(int enabled);
+int output_capture_enabled(void);
+job *add_job(pid_t pid, command *cmd, int capture_fds[2], tee_relay *tee);
+int wait_for_job(job *j);
+int wait_for_job_usage(job *j, struct rusage *usage);
+int wait_for_input(int fd);
+int wait_for_activity(int fd, int timeout_ms);
+void cancel_job(job *j);
+void reset_jobs(void);
+void poll_jobs(void);
+void report_finished_jobs(void);
+int handle_jobs_command(char **arguments, int num_arguments);
+
+#endif
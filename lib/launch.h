@@ -0,0 +1,15 @@
+#ifndef LAUNCH_H
+#define LAUNCH_H
+
+#include "command.h"
+
+int parse_cpu_list(const char *text, launch_options *launch);
+int parse_nice(const char *text, launch_options *launch);
+int parse_limit(const char *text, launch_options *launch);
+int has_launch_options(const launch_options *launch);
+void set_job_pinning(int enabled);
+int job_pinning_enabled(void);
+void assign_job_cpu(launch_options *launch);
+void apply_launch_options(const launch_options *launch);
+
+#endif
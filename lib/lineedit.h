@@ -0,0 +1,8 @@
+#ifndef LINEEDIT_H
+#define LINEEDIT_H
+
+#include <stddef.h>
+
+char *read_line(const char *prompt, char *buffer, size_t size);
+
+#endif
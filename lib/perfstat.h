@@ -0,0 +1,23 @@
+#ifndef PERFSTAT_H
+#define PERFSTAT_H
+
+#include <sys/types.h>
+
+#include "command.h"
+
+#define NUM_PERF_EVENTS 10
+#define NUM_HARDWARE_EVENTS 6              // The first events of the table, the rest are software events
+#define PERF_LOG_VARIABLE "MYSHELL_PERF_LOG" // JSON-lines file every 'perfstat' result is appended to
+
+/* The counters of one 'perfstat' command, opened on its child */
+typedef struct perf_counters {
+    int fds[NUM_PERF_EVENTS]; // -1 for the events the kernel refused
+    int user_only;            // Kernel time is excluded (perf_event_paranoid >= 2)
+    int hardware_error;       // errno of the hardware events, 0 if they were opened
+    double started;           // Monotonic time the child was released
+} perf_counters;
+
+int open_perf_counters(pid_t pid, perf_counters *counters);
+void report_perf_counters(perf_counters *counters, const command *cmd, int status);
+
+#endif
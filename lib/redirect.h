@@ -0,0 +1,33 @@
+#ifndef REDIRECT_H
+#define REDIRECT_H
+
+#include <stddef.h>
+
+#include "arena.h"
+#include "command.h"
+
+#define TEE_CHUNK_SIZE 1048576 // Also the size requested for relay pipes
+
+/* Copies the output of a command from one pipe into several files. */
+typedef struct tee_relay {
+    int source;                  // Read end of the command's stdout pipe
+    int files[MAX_TEE_TARGETS];  // Opened targets
+    int pipes[MAX_TEE_TARGETS][2]; // Pipes feeding all targets but the last
+    int num_files;
+    int copy;                    // 1 once tee()/splice() turned out unusable
+} tee_relay;
+
+/* Returns the next line of input without its newline, or NULL at the end.
+ * The line stays valid until the next call. */
+typedef char *(*line_reader)(void *context);
+
+int write_all(int fd, const char *buffer, size_t length);
+int open_output_file(const char *path, redirect mode);
+int open_input(const command *cmd);
+int find_here_document(const char *line, char *delimiter, size_t size);
+char *read_here_document(const char *delimiter, line_reader next, void *context, arena *a);
+tee_relay *create_tee_relay(int source, char **paths, int num_paths);
+int pump_tee_relay(tee_relay *relay);
+void free_tee_relay(tee_relay *relay);
+
+#endif
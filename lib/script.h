@@ -0,0 +1,61 @@
+#ifndef SCRIPT_H
+#define SCRIPT_H
+
+#include <sys/types.h>
+#include <time.h>
+
+#include "arena.h"
+#include "command.h"
+
+#define MAX_PLANS 64
+#define PLAN_MAGIC "myshell-plan 12"
+
+/* A command of a script line after the front end (alias substitution,
+ * tokenize, split_chain and parse_command) has run. Lines whose words
+ * depend on the file system at run time (globs, $(...)) keep their alias
+ * substituted source instead and are tokenized when they run. Strings live
+ * in the owning plan's arena. */
+typedef struct plan_entry {
+    operation op;
+    connector connector; // How it depends on the status of the entry before
+    int background;
+    redirect redirect;
+    int num_arguments;
+    char **arguments;
+    char *output_file;
+    int num_tee_files;
+    char **tee_files;
+    input_redirect input;
+    char *input_source;
+    char *document;   // Body of the line's here document, or NULL
+    char *executable; // Resolved for OTHER commands, NULL if not found
+    char *source;     // Set for lines that are expanded when they run
+    launch_options launch;
+} plan_entry;
+
+/* The version of a file a plan was compiled against; all zero for a file
+ * that did not exist */
+typedef struct file_identity {
+    dev_t device;
+    ino_t inode;
+    struct timespec mtime;
+    off_t size;
+} file_identity;
+
+/* A compiled script, valid as long as the file keeps its inode and mtime,
+ * and the aliases and PATH its lines were expanded with are unchanged. */
+typedef struct plan {
+    char *path;
+    file_identity script;
+    file_identity aliases; // .aliases when compilation started
+    char *search_path;     // PATH when compilation started, NULL if unset
+    plan_entry *entries;
+    int count;
+    int capacity;
+    int active; // Number of run_script() calls currently executing it
+    arena strings;
+} plan;
+
+int run_script(const char *path);
+
+#endif
@@ -0,0 +1,26 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include <stdint.h>
+
+#define SERVER_MAGIC 0x6d797368 // "mysh"
+#define SERVER_BACKLOG 128
+#define SERVER_FDS 3 // The client's stdin, stdout and stderr
+
+/* A request on the socket of 'myshell --serve': this header, then length
+ * bytes of the command line. The client's stdin, stdout and stderr are
+ * attached to the header as SCM_RIGHTS, so the command reads and writes
+ * them directly. */
+typedef struct server_request {
+    uint32_t magic;
+    uint32_t length;
+} server_request;
+
+/* The answer, sent once the command finished */
+typedef struct server_reply {
+    int32_t status; // Exit status of the command line
+} server_reply;
+
+int run_server(const char *socket_path);
+
+#endif
@@ -0,0 +1,11 @@
+#ifndef SUBSTITUTE_H
+#define SUBSTITUTE_H
+
+#include "arena.h"
+#include "tokenize.h"
+
+int has_substitution(const char *token);
+int in_substitution(void);
+int expand_substitutions(char *tokens[], int quoted[], int tokenCount, int max_tokens, arena *words);
+
+#endif
@@ -1,9 +1,22 @@
+#ifndef TOKENIZE_H
+#define TOKENIZE_H
+
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 
 #define MAX_TOKENS 256
 #define MAX_TOKEN_LENGTH 256
+#define MAX_INPUT_LENGTH 512
+
+// Flags tokenize_words() and the expansions record for every token
+#define TOKEN_QUOTED 1      // Written in double quotes, never expanded again
+#define TOKEN_SUBSTITUTED 2 // A word of $(...) output, owned by an arena
 
 int tokenize(char *input, char *tokens[MAX_TOKENS]);
+int tokenize_words(char *input, char *tokens[MAX_TOKENS], int quoted[MAX_TOKENS]);
 void print_tokens(char *tokens[MAX_TOKENS], int tokenCount);
+void free_tokens(char *tokens[MAX_TOKENS], int tokenCount);
+void free_token_words(char *tokens[MAX_TOKENS], const int quoted[MAX_TOKENS], int tokenCount);
+
+#endif
@@ -0,0 +1,23 @@
+#ifndef URING_H
+#define URING_H
+
+#include <stddef.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#define URING_ENTRIES 64           // Submission queue size, enough for a whole relay batch
+#define URING_CHUNK_SIZE 1048576   // Size of each registered buffer
+#define URING_BUFFERS 2            // One is written out while the next is read
+
+/* How the shell moves the data of '>|' relays and captured output.
+ * Chosen with MYSHELL_IO=splice|rw|uring when the shell starts. */
+typedef enum io_backend { IO_SPLICE,     // tee()/splice() where possible (default)
+                          IO_READ_WRITE, // Plain read()/write() through user space
+                          IO_URING } io_backend; // Batched io_uring submissions
+
+io_backend current_io_backend(void);
+void reset_uring(void);
+int uring_pump_copy(int source, const int files[], int num_files);
+int uring_readv_all(const int fds[], struct iovec vectors[][2], ssize_t results[], int count);
+
+#endif
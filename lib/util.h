@@ -0,0 +1,9 @@
+#ifndef UTIL_H
+#define UTIL_H
+
+#include <stdio.h>
+
+double monotonic_seconds(void);
+void write_json_string(FILE *file, const char *text);
+
+#endif
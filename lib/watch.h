@@ -0,0 +1,11 @@
+#ifndef WATCH_H
+#define WATCH_H
+
+#include "command.h"
+
+#define DEFAULT_DEBOUNCE_MS 100 // Quiet time after a change before the command runs
+#define MAX_WATCHED_PATHS 64    // Paths given to --paths
+
+int handle_watch_command(command *cmd);
+
+#endif
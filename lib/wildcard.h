@@ -0,0 +1,39 @@
+#ifndef WILDCARD_H
+#define WILDCARD_H
+
+#include <stdint.h>
+#include <time.h>
+
+#include "dirscan.h"
+#include "tokenize.h"
+
+#define MAX_PATTERN_ELEMENTS 256
+#define MAX_LISTING_CACHE 32
+
+/* A glob pattern compiled for matching one path component. Every element
+ * is the set of bytes it accepts; '*' splits the elements into segments. */
+typedef struct compiled_pattern {
+    uint32_t elements[MAX_PATTERN_ELEMENTS][8];
+    int num_elements;
+    int segment_start[MAX_PATTERN_ELEMENTS + 1];
+    int segment_length[MAX_PATTERN_ELEMENTS + 1];
+    int num_segments;
+    int leading_star;  // The pattern starts with '*'
+    int trailing_star; // The pattern ends with '*'
+    int match_dot;     // The pattern may match names starting with '.'
+} compiled_pattern;
+
+/* A directory listing kept for repeated globs, valid while the directory
+ * keeps its mtime. */
+typedef struct cached_listing {
+    char *path;
+    struct timespec mtime;
+    directory_listing listing;
+} cached_listing;
+
+int has_wildcard(const char *word);
+int compile_pattern(const char *pattern, size_t length, compiled_pattern *compiled);
+int match_pattern(const compiled_pattern *compiled, const char *name, size_t length);
+int expand_wildcards(char *tokens[], int quoted[], int tokenCount, int max_tokens);
+
+#endif
@@ -0,0 +1,112 @@
+#!/bin/sh
+# Runs every builtin filter form with 'filters on' and 'filters off' over
+# the same inputs, and reports any difference in stdout or exit status. A
+# shell that hangs is stopped after 10 s and counts as exit status 124.
+#
+# usage: scripts/filters_diff.sh [SHELL]   (./myshell by default)
+
+SHELL_UNDER_TEST=$(cd "$(dirname "${1:-./myshell}")" && pwd)/$(basename "${1:-./myshell}")
+if [ ! -x "$SHELL_UNDER_TEST" ]; then
+    echo "filters_diff: $SHELL_UNDER_TEST is not executable, run make first" >&2
+    exit 2
+fi
+
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+cd "$WORK" || exit 2
+
+# Inputs
+: > empty
+printf 'alpha\nbeta\nalphabet\ngamma' > nofinal
+i=0
+while [ $i -lt 2000 ]; do
+    echo "line $i alpha beta $((i * 7 % 13))"
+    i=$((i + 1))
+done > lines
+i=0
+while [ $i -lt 16 ]; do
+    cat lines
+    i=$((i + 1))
+done | tr -d '\n' > longline
+{ cat longline; echo; echo alpha; cat longline; echo alpha; } > long
+i=0
+while [ $i -lt 256 ]; do
+    printf "\\$(printf %03o $i)"
+    i=$((i + 1))
+done > bytes
+{ cat bytes bytes; printf 'alpha\n'; cat bytes; printf '\000\000beta'; } > binary
+
+# Filter forms, FILE marks where the input file goes
+FORMS='wc -l FILE
+head FILE
+head -n 3 FILE
+head -n3 FILE
+head -n 0 FILE
+head -n 100000 FILE
+grep -F alpha FILE
+grep -F zzz FILE
+grep -F a FILE
+tr a-z A-Z
+tr abc xyz
+tr -d a
+tr -d a-z'
+INPUTS='empty nofinal lines long binary missing'
+
+# Whole pipelines whose upstream stage is stopped by its 'timeout' while
+# the filters wait for input
+PIPELINES='timeout 1 cat /dev/zero | wc -l
+timeout 1 cat /dev/zero | tr -d a | grep -F x
+timeout 1 yes | grep -F zzz'
+
+run() { # run MODE LINE, prints the exit status
+    rm -f "out.$1"
+    printf 'filters %s\n%s > out.%s\n' "$1" "$2" "$1" > script
+    timeout 10 "$SHELL_UNDER_TEST" script > "shell.$1" 2> /dev/null
+    echo $? # 124 if the shell hung
+}
+
+same() { # same FILE1 FILE2, true if both are missing or equal
+    if [ -f "$1" ] && [ -f "$2" ]; then
+        cmp -s "$1" "$2"
+    else
+        [ ! -f "$1" ] && [ ! -f "$2" ]
+    fi
+}
+
+check() { # check LINE, records a failure if the modes differ
+    on=$(run on "$1")
+    off=$(run off "$1")
+    if [ "$on" != "$off" ] || ! same out.on out.off || ! same shell.on shell.off; then
+        echo "FAIL: $1 (status on=$on off=$off)"
+        echo x >> failures
+    fi
+    echo x >> cases
+}
+
+failed=0
+echo "$FORMS" | while IFS= read -r form; do
+    for input in $INPUTS; do
+        case "$form" in
+        *FILE) lines="$(echo "$form" | sed "s/FILE/$input/")
+$(echo "$form" | sed "s/ FILE//") < $input
+cat $input | $(echo "$form" | sed "s/ FILE//") | cat" ;;
+        *) lines="$form < $input
+cat $input | $form | cat" ;;
+        esac
+        echo "$lines" | while IFS= read -r line; do
+            if [ "$input" = missing ] && [ "${line#cat}" != "$line" ]; then
+                continue # The status is cat's, not the filter's
+            fi
+            check "$line"
+        done
+    done
+done
+
+echo "$PIPELINES" | while IFS= read -r line; do
+    check "$line"
+done
+
+total=$(wc -l < cases 2> /dev/null || echo 0)
+[ -f failures ] && failed=$(wc -l < failures)
+echo "filters_diff: $((total - failed))/$total cases match"
+[ "$failed" -eq 0 ]
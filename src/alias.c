@@ -1,4 +1,7 @@
+#include <ctype.h>
+
 #include "../lib/alias.h"
+#include "../lib/tokenize.h"
 
 /*
  * Function:  create_alias
@@ -123,3 +126,126 @@ int handle_alias_command(char **tokens, int tokenCount) {
 
     return result;
 }
+
+/* Function: trim_whitespace
+ * --------------------
+ * Trims trailing whitespace from a string in place. Leading whitespace is
+ * only skipped to find where the text ends; it stays in the string, since
+ * the caller's pointer cannot move.
+ *
+ * str: The string to be trimmed.
+ *
+ * returns: void
+ */
+static void trim_whitespace(char *str) {
+    if (str == NULL)
+        return;
+
+    char *end;
+
+    // Trim leading space
+    while (isspace((unsigned char)*str))
+        str++;
+
+    if (*str == 0) { // All spaces?
+        return;
+    }
+
+    // Trim trailing space
+    end = str + strlen(str) - 1;
+    while (end > str && isspace((unsigned char)*end))
+        end--;
+
+    // Write new null terminator
+    *(end + 1) = 0;
+}
+
+/* Function: get_alias
+ * --------------------
+ * Gets the value of an alias.
+ *
+ * alias_name: The name of the alias.
+ * buffer: The buffer to store the alias value.
+ * buffer_size: The size of the buffer.
+ *
+ * returns: void
+ */
+void get_alias(const char *alias_name, char *buffer, size_t buffer_size) {
+    FILE *file = fopen(".aliases", "r");
+    if (!file) {
+        perror("Error opening .aliases file");
+        return;
+    }
+
+    char line[MAX_ALIASES];
+    int found = 0;
+
+    while (fgets(line, sizeof(line), file)) {
+        char *key = strtok(line, "=");
+        char *value = strtok(NULL, "\n");
+
+        if (key) {
+            trim_whitespace(key);
+        }
+        if (value) {
+            trim_whitespace(value);
+        }
+
+        if (key && value && strcmp(key, alias_name) == 0) {
+            strncpy(buffer, value, buffer_size);
+            buffer[buffer_size - 1] = '\0'; // Ensure null termination
+            found = 1;
+            break;
+        }
+    }
+
+    if (!found) {
+        buffer[0] = '\0'; // Set buffer to empty string if alias not found
+    }
+
+    fclose(file);
+}
+
+/* Function: replace_alias_in_command
+ * --------------------
+ * Replaces an alias name with its value in a command.
+ *
+ * input: The command to be processed.
+ * output: The processed command.
+ * max_output_length: The maximum length of the output buffer.
+ *
+ * returns: void
+ */
+void replace_alias_in_command(char *input, char *output, size_t max_output_length) {
+    char temp_input[MAX_INPUT_LENGTH];
+    strncpy(temp_input, input, MAX_INPUT_LENGTH);
+    temp_input[MAX_INPUT_LENGTH - 1] = '\0'; // Ensure null termination
+
+    char *alias_name = strtok(temp_input, " ");
+    char alias_value[MAX_INPUT_LENGTH] = {0};
+
+    if (alias_name) {
+        get_alias(alias_name, alias_value, sizeof(alias_value));
+        if (strlen(alias_value) > 0) {
+            // Alias found
+            snprintf(output, max_output_length, "%s", alias_value);
+            char *remainder = input + strlen(alias_name);
+            while (*remainder == ' ')
+                remainder++; // Skip spaces to find the start of the next token
+
+            if (*remainder != '\0') {
+                // Ensure we don't exceed buffer size
+                size_t current_length = strlen(output);
+                snprintf(output + current_length, max_output_length - current_length, " %s", remainder);
+            }
+        } else {
+            // Alias not found, copy original input
+            strncpy(output, input, max_output_length);
+            output[max_output_length - 1] = '\0'; // Ensure null termination
+        }
+    } else {
+        // Input was only whitespace or empty
+        strncpy(output, input, max_output_length);
+        output[max_output_length - 1] = '\0'; // Ensure null termination
+    }
+}
\ No newline at end of file
@@ -0,0 +1,117 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "../lib/arena.h"
+
+/* Function: arena_alloc
+ * --------------------
+ * Allocates memory from an arena. Memory is carved out of large blocks, so
+ * many small allocations cost one malloc() and are released together by
+ * arena_free(). Requests larger than ARENA_BLOCK_SIZE get a block of their
+ * own.
+ *
+ * a: the arena to allocate from (zero-initialized before first use)
+ * size: the number of bytes to allocate
+ *
+ * returns: a pointer aligned for any type, or NULL if allocation failed
+ */
+void *arena_alloc(arena *a, size_t size) {
+    size = (size + 15) & ~(size_t)15; // Keep every allocation 16-byte aligned
+
+    arena_block *block = a->head;
+    if (block == NULL || block->size - block->used < size) {
+        size_t block_size = size > ARENA_BLOCK_SIZE ? size : ARENA_BLOCK_SIZE;
+        block = malloc(sizeof(arena_block) + block_size);
+        if (block == NULL) {
+            return NULL;
+        }
+        block->used = 0;
+        block->size = block_size;
+
+        // Oversized blocks go behind the head so the head keeps its free space
+        if (a->head != NULL && block_size > ARENA_BLOCK_SIZE) {
+            block->next = a->head->next;
+            a->head->next = block;
+        } else {
+            block->next = a->head;
+            a->head = block;
+        }
+    }
+
+    void *ptr = block->data + block->used;
+    block->used += size;
+    return ptr;
+}
+
+/* Function: arena_strndup
+ * --------------------
+ * Copies the first length bytes of a string into an arena and null
+ * terminates the copy.
+ *
+ * returns: the copy, or NULL if allocation failed
+ */
+char *arena_strndup(arena *a, const char *s, size_t length) {
+    char *copy = arena_alloc(a, length + 1);
+    if (copy == NULL) {
+        return NULL;
+    }
+    memcpy(copy, s, length);
+    copy[length] = '\0';
+    return copy;
+}
+
+/* Function: arena_strdup
+ * --------------------
+ * Copies a null terminated string into an arena.
+ *
+ * returns: the copy, or NULL if allocation failed
+ */
+char *arena_strdup(arena *a, const char *s) {
+    return arena_strndup(a, s, strlen(s));
+}
+
+/* Function: arena_buffer_reserve
+ * --------------------
+ * Makes room for at least size more bytes at the end of a buffer. The
+ * capacity at least doubles when the buffer moves, so appending n bytes in
+ * total copies O(n) bytes.
+ *
+ * a: the arena the buffer lives in
+ * buffer: the buffer (zero-initialized before first use)
+ * size: the number of bytes about to be appended
+ *
+ * returns: a pointer to the free space after the buffer's data, or NULL if
+ * allocation failed
+ */
+char *arena_buffer_reserve(arena *a, arena_buffer *buffer, size_t size) {
+    if (buffer->capacity - buffer->length < size) {
+        size_t capacity = buffer->capacity ? buffer->capacity * 2 : ARENA_BLOCK_SIZE;
+        while (capacity - buffer->length < size) {
+            capacity *= 2;
+        }
+        char *data = arena_alloc(a, capacity);
+        if (data == NULL) {
+            return NULL;
+        }
+        if (buffer->length > 0) {
+            memcpy(data, buffer->data, buffer->length);
+        }
+        buffer->data = data;
+        buffer->capacity = capacity;
+    }
+    return buffer->data + buffer->length;
+}
+
+/* Function: arena_free
+ * --------------------
+ * Releases every block owned by an arena. The arena can be reused afterwards.
+ */
+void arena_free(arena *a) {
+    arena_block *block = a->head;
+    while (block != NULL) {
+        arena_block *next = block->next;
+        free(block);
+        block = next;
+    }
+    a->head = NULL;
+}
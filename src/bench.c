@@ -0,0 +1,535 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include "../lib/bench.h"
+#include "../lib/executor.h"
+#include "../lib/jobs.h"
+#include "../lib/launch.h"
+#include "../lib/tokenize.h"
+#include "../lib/util.h"
+
+/* One run of a benchmarked command, times in seconds */
+typedef struct bench_sample {
+    double wall;
+    double user;
+    double sys;
+    int status;
+    int outlier;
+} bench_sample;
+
+/* The statistics of one command over the runs that were kept */
+typedef struct bench_summary {
+    int kept;
+    int outliers;
+    int failures; // Runs that exited with a nonzero status
+    double mean;
+    double median;
+    double stddev;
+    double error; // Half width of the 95% confidence interval of the mean
+    double user;
+    double sys;
+} bench_summary;
+
+/* A command given to 'bench', parsed once and spawned for every run */
+typedef struct bench_command {
+    const char *text;
+    char *tokens[MAX_TOKENS];
+    int quoted[MAX_TOKENS];
+    int num_tokens;
+    command cmd;
+    char executable[MAX_PATH_LENGTH];
+    bench_sample *samples;
+    int num_samples;
+    bench_summary summary;
+} bench_command;
+
+static volatile sig_atomic_t stopping = 0;
+
+/* Function: stop_bench
+ * --------------------
+ * Handles SIGINT while 'bench' runs: the runs so far are reported instead
+ * of the shell exiting.
+ */
+static void stop_bench(int signal) {
+    (void)signal;
+    stopping = 1;
+}
+
+/* Function: seconds
+ * --------------------
+ * returns: a time of struct rusage in seconds
+ */
+static double seconds(struct timeval time) {
+    return time.tv_sec + time.tv_usec / 1e6;
+}
+
+/* Function: prepare_command
+ * --------------------
+ * Parses a command given to 'bench' with the shell's own front end. Only
+ * single external commands can be spawned directly, with their
+ * redirections and prefix builtins; the launch options of the 'bench'
+ * itself apply to commands without their own.
+ *
+ * returns: 0 on success, -1 after printing an error
+ */
+static int prepare_command(bench_command *b, const char *text, const launch_options *launch) {
+    char line[MAX_INPUT_LENGTH];
+    snprintf(line, sizeof(line), "%s", text);
+    b->text = text;
+    b->num_tokens = tokenize_words(line, b->tokens, b->quoted);
+    if (b->num_tokens <= 0) {
+        b->num_tokens = 0;
+        printf("Error: Empty command for 'bench'.\n");
+        return -1;
+    }
+    for (int i = 0; i < b->num_tokens; i++) {
+        if (!b->quoted[i] && (strcmp(b->tokens[i], "|") == 0 || is_chain_operator(b->tokens[i]))) {
+            printf("Error: 'bench' runs single commands, not '%s'.\n", text);
+            return -1;
+        }
+    }
+
+    b->cmd = parse_command(b->tokens, b->num_tokens);
+    if (b->cmd.op == INVALID) {
+        run_command(&b->cmd, NULL); // Prints the error
+        return -1;
+    }
+    if (b->cmd.op != OTHER || b->cmd.background) {
+        printf("Error: '%s' cannot be used with 'bench'.\n", b->cmd.op != OTHER ? b->cmd.arguments[0] : "&");
+        return -1;
+    }
+    if (!has_launch_options(&b->cmd.launch)) {
+        b->cmd.launch = *launch;
+    }
+    b->cmd.launch.perfstat = 0; // Its report would be timed with the command
+
+    // Only redirections, such as "> q", leave nothing to run
+    if (b->cmd.num_arguments == 0 || b->cmd.arguments[0] == NULL) {
+        printf("Error: Empty command for 'bench'.\n");
+        return -1;
+    }
+    char *found = find_executable(b->cmd.arguments[0]);
+    if (found == NULL) {
+        printf("myshell: command not found: %s\n", b->cmd.arguments[0]);
+        return -1;
+    }
+    snprintf(b->executable, sizeof(b->executable), "%s", found);
+    return 0;
+}
+
+/* Function: run_once
+ * --------------------
+ * Runs a command once through the normal spawn path, with /dev/null as
+ * its stdin and stdout unless it redirects them itself.
+ *
+ * sample: receives the times and the exit status, may be NULL for warmup
+ *
+ * returns: 0 on success, -1 if the command could not be run
+ */
+static int run_once(bench_command *b, int null_fd, bench_sample *sample) {
+    command cmd = b->cmd; // spawn_command() writes into the arguments
+    int stdio[2] = {null_fd, null_fd};
+    job *started = NULL;
+
+    double start = monotonic_seconds();
+    if (spawn_command(&cmd, b->executable, stdio, &started) != 0 || started == NULL) {
+        return -1;
+    }
+    struct rusage usage;
+    int status = wait_for_job_usage(started, &usage);
+    double wall = monotonic_seconds() - start;
+
+    if (sample != NULL) {
+        sample->wall = wall;
+        sample->user = seconds(usage.ru_utime);
+        sample->sys = seconds(usage.ru_stime);
+        sample->status = status;
+        sample->outlier = 0;
+    }
+    return 0;
+}
+
+/* Function: compare_doubles
+ * --------------------
+ * Orders doubles for qsort().
+ */
+static int compare_doubles(const void *a, const void *b) {
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/* Function: percentile
+ * --------------------
+ * returns: the percentile p (0 to 1) of sorted values, interpolated
+ * between the two nearest ranks
+ */
+static double percentile(const double sorted[], int count, double p) {
+    double rank = p * (count - 1);
+    int below = (int)rank;
+    if (below + 1 >= count) {
+        return sorted[count - 1];
+    }
+    return sorted[below] + (rank - below) * (sorted[below + 1] - sorted[below]);
+}
+
+/* Function: t_critical
+ * --------------------
+ * returns: the two-sided 95% critical value of Student's t distribution
+ */
+static double t_critical(int degrees) {
+    static const double table[] = {12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+                                   2.201,  2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+                                   2.080,  2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042};
+    if (degrees < 1) {
+        return 0;
+    }
+    if (degrees <= 30) {
+        return table[degrees - 1];
+    }
+    return degrees <= 40 ? 2.021 : degrees <= 60 ? 2.000 : degrees <= 120 ? 1.980 : 1.960;
+}
+
+/* Function: summarize
+ * --------------------
+ * Rejects the outliers of a command's wall times with Tukey's fences
+ * (OUTLIER_FENCE times the interquartile range beyond the quartiles) and
+ * computes the statistics of the runs that are left.
+ */
+static void summarize(bench_command *b) {
+    bench_summary *s = &b->summary;
+    memset(s, 0, sizeof(*s));
+    int count = b->num_samples;
+    if (count == 0) {
+        return;
+    }
+
+    double *sorted = malloc(count * sizeof(double));
+    if (sorted == NULL) {
+        return;
+    }
+    for (int i = 0; i < count; i++) {
+        sorted[i] = b->samples[i].wall;
+        s->failures += b->samples[i].status != 0;
+    }
+    qsort(sorted, count, sizeof(double), compare_doubles);
+    if (count >= MIN_OUTLIER_RUNS) {
+        double q1 = percentile(sorted, count, 0.25);
+        double q3 = percentile(sorted, count, 0.75);
+        double low = q1 - OUTLIER_FENCE * (q3 - q1);
+        double high = q3 + OUTLIER_FENCE * (q3 - q1);
+        for (int i = 0; i < count; i++) {
+            b->samples[i].outlier = b->samples[i].wall < low || b->samples[i].wall > high;
+            s->outliers += b->samples[i].outlier;
+        }
+    }
+
+    int kept = 0;
+    double sum = 0;
+    for (int i = 0; i < count; i++) {
+        if (!b->samples[i].outlier) {
+            sorted[kept++] = b->samples[i].wall;
+            sum += b->samples[i].wall;
+            s->user += b->samples[i].user;
+            s->sys += b->samples[i].sys;
+        }
+    }
+    qsort(sorted, kept, sizeof(double), compare_doubles);
+    s->kept = kept;
+    s->mean = sum / kept;
+    s->median = percentile(sorted, kept, 0.5);
+    s->user /= kept;
+    s->sys /= kept;
+    double squares = 0;
+    for (int i = 0; i < kept; i++) {
+        squares += (sorted[i] - s->mean) * (sorted[i] - s->mean);
+    }
+    s->stddev = kept > 1 ? sqrt(squares / (kept - 1)) : 0;
+    s->error = kept > 1 ? t_critical(kept - 1) * s->stddev / sqrt(kept) : 0;
+    free(sorted);
+}
+
+/* Function: print_summary
+ * --------------------
+ * Prints the statistics of one command, times in milliseconds.
+ */
+static void print_summary(const bench_command *b, int index) {
+    const bench_summary *s = &b->summary;
+    printf("[%d] %s\n", index, b->text);
+    if (s->kept == 0) {
+        printf("    no runs\n");
+        return;
+    }
+    printf("    wall  mean %.3f ms ± %.3f ms (95%% CI), median %.3f ms, sd %.3f ms\n", s->mean * 1e3,
+           s->error * 1e3, s->median * 1e3, s->stddev * 1e3);
+    printf("    cpu   user %.3f ms, sys %.3f ms\n", s->user * 1e3, s->sys * 1e3);
+    printf("    %d of %d runs kept, %d outlier%s rejected\n", s->kept, b->num_samples, s->outliers,
+           s->outliers == 1 ? "" : "s");
+    if (s->failures > 0) {
+        printf("    warning: %d run%s exited with a nonzero status\n", s->failures, s->failures == 1 ? "" : "s");
+    }
+}
+
+/* Function: print_speedup
+ * --------------------
+ * Compares a command with the first one: the ratio of the mean wall
+ * times, with the uncertainty of both means carried over.
+ */
+static void print_speedup(const bench_command *baseline, const bench_command *b, int index) {
+    const bench_summary *x = &baseline->summary;
+    const bench_summary *y = &b->summary;
+    if (x->kept == 0 || y->kept == 0 || x->mean <= 0 || y->mean <= 0) {
+        return;
+    }
+    int faster = y->mean < x->mean;
+    double ratio = faster ? x->mean / y->mean : y->mean / x->mean;
+    double error = ratio * sqrt(pow(x->error / x->mean, 2) + pow(y->error / y->mean, 2));
+    printf("    [%d] is %.3fx ± %.3f %s than [1]%s\n", index, ratio, error, faster ? "faster" : "slower",
+           ratio - error <= 1 ? " (not significant)" : "");
+}
+
+/* Function: write_csv_text
+ * --------------------
+ * Writes a CSV field, quoted.
+ */
+static void write_csv_text(FILE *file, const char *text) {
+    fputc('"', file);
+    for (const char *c = text; *c != '\0'; c++) {
+        if (*c == '"') {
+            fputc('"', file);
+        }
+        fputc(*c, file);
+    }
+    fputc('"', file);
+}
+
+/* Function: export_csv
+ * --------------------
+ * Writes every run of every command, one row each. The launch overhead
+ * probe is the command named "(launch)".
+ *
+ * returns: 0 on success, -1 on error
+ */
+static int export_csv(const char *path, bench_command *commands, int count) {
+    FILE *file = fopen(path, "w");
+    if (file == NULL) {
+        fprintf(stderr, "myshell: bench: %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    fprintf(file, "command,run,wall_s,user_s,sys_s,status,outlier\n");
+    for (int i = 0; i < count; i++) {
+        for (int run = 0; run < commands[i].num_samples; run++) {
+            const bench_sample *sample = &commands[i].samples[run];
+            write_csv_text(file, commands[i].text);
+            fprintf(file, ",%d,%.9f,%.6f,%.6f,%d,%d\n", run + 1, sample->wall, sample->user, sample->sys,
+                    sample->status, sample->outlier);
+        }
+    }
+    if (fclose(file) != 0) {
+        fprintf(stderr, "myshell: bench: %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+/* Function: export_json
+ * --------------------
+ * Writes the statistics and every run of every command as one JSON
+ * object, times in seconds.
+ *
+ * returns: 0 on success, -1 on error
+ */
+static int export_json(const char *path, bench_command *commands, int count, int warmup) {
+    FILE *file = fopen(path, "w");
+    if (file == NULL) {
+        fprintf(stderr, "myshell: bench: %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    fprintf(file, "{\"warmup\":%d,\"commands\":[", warmup);
+    for (int i = 0; i < count; i++) {
+        const bench_summary *s = &commands[i].summary;
+        fprintf(file, "%s\n{\"command\":", i ? "," : "");
+        write_json_string(file, commands[i].text);
+        fprintf(file,
+                ",\"runs\":%d,\"kept\":%d,\"outliers\":%d,\"failures\":%d,\"mean\":%.9f,\"median\":%.9f,"
+                "\"stddev\":%.9f,\"ci_low\":%.9f,\"ci_high\":%.9f,\"user\":%.6f,\"sys\":%.6f,\"samples\":[",
+                commands[i].num_samples, s->kept, s->outliers, s->failures, s->mean, s->median, s->stddev,
+                s->mean - s->error, s->mean + s->error, s->user, s->sys);
+        for (int run = 0; run < commands[i].num_samples; run++) {
+            const bench_sample *sample = &commands[i].samples[run];
+            fprintf(file, "%s{\"wall\":%.9f,\"user\":%.6f,\"sys\":%.6f,\"status\":%d,\"outlier\":%s}", run ? "," : "",
+                    sample->wall, sample->user, sample->sys, sample->status, sample->outlier ? "true" : "false");
+        }
+        fprintf(file, "]}");
+    }
+    fprintf(file, "\n]}\n");
+    if (fclose(file) != 0) {
+        fprintf(stderr, "myshell: bench: %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+/* Function: parse_count
+ * --------------------
+ * returns: 0 if text is a whole number from minimum to MAX_BENCH_RUNS,
+ * -1 otherwise
+ */
+static int parse_count(const char *text, int minimum, int *value) {
+    char *end;
+    long number = strtol(text, &end, 10);
+    if (end == text || *end != '\0' || number < minimum || number > MAX_BENCH_RUNS) {
+        return -1;
+    }
+    *value = (int)number;
+    return 0;
+}
+
+/* Function: handle_bench_command
+ * --------------------
+ * Handles the 'bench' builtin:
+ * bench [-n RUNS] [--warmup N] [--csv FILE] [--json FILE] "cmd A" "cmd B"...
+ *
+ * Runs every command N times unmeasured and then RUNS times measured,
+ * taking turns so that drift affects them alike. Each run is spawned like
+ * any external command and waited for by the job supervisor, which gives
+ * its wall, user and system time. The cost of the spawn itself is
+ * measured with 'true' the same way and reported separately. Outliers are
+ * rejected per command; the mean with its 95% confidence interval, the
+ * median and the ratio to the first command are printed, and the raw runs
+ * can be exported. Ctrl-C stops early and reports the runs so far.
+ *
+ * returns: 0 if the benchmark ran, 1 or 2 on errors
+ */
+int handle_bench_command(command *cmd) {
+    int runs = DEFAULT_BENCH_RUNS;
+    int warmup = DEFAULT_BENCH_WARMUP;
+    const char *csv_path = NULL;
+    const char *json_path = NULL;
+
+    int first = 1;
+    while (first < cmd->num_arguments && cmd->arguments[first][0] == '-' && cmd->arguments[first][1] != '\0') {
+        const char *option = cmd->arguments[first];
+        const char *value = first + 1 < cmd->num_arguments ? cmd->arguments[first + 1] : NULL;
+        if (strcmp(option, "--") == 0) {
+            first++;
+            break;
+        }
+        if (value == NULL) {
+            printf("Error: Invalid syntax for 'bench' command.\n");
+            return 2;
+        }
+        if (strcmp(option, "-n") == 0 && parse_count(value, 1, &runs) == 0) {
+        } else if (strcmp(option, "--warmup") == 0 && parse_count(value, 0, &warmup) == 0) {
+        } else if (strcmp(option, "--csv") == 0) {
+            csv_path = value;
+        } else if (strcmp(option, "--json") == 0) {
+            json_path = value;
+        } else {
+            printf("Error: Invalid syntax for 'bench' command.\n");
+            return 2;
+        }
+        first += 2;
+    }
+    int count = cmd->num_arguments - first;
+    if (count < 1 || count > MAX_BENCH_COMMANDS) {
+        printf("Error: 'bench' takes 1 to %d commands.\n", MAX_BENCH_COMMANDS);
+        return 2;
+    }
+
+    // The commands, then 'true' to measure what the spawn itself costs
+    bench_command *commands = calloc(count + 1, sizeof(bench_command));
+    if (commands == NULL) {
+        perror("calloc");
+        return 1;
+    }
+    int total = count;
+    int status = 0;
+    for (int i = 0; i < count && status == 0; i++) {
+        status = prepare_command(&commands[i], cmd->arguments[first + i], &cmd->launch);
+    }
+    if (status == 0 && find_executable("true") != NULL) {
+        status = prepare_command(&commands[count], "true", &cmd->launch);
+        commands[count].text = "(launch)";
+        total++;
+    }
+    for (int i = 0; i < total && status == 0; i++) {
+        commands[i].samples = malloc(runs * sizeof(bench_sample));
+        if (commands[i].samples == NULL) {
+            perror("malloc");
+            status = -1;
+        }
+    }
+
+    int null_fd = open("/dev/null", O_RDWR | O_CLOEXEC);
+    if (status == 0 && null_fd < 0) {
+        perror("/dev/null");
+        status = -1;
+    }
+
+    struct sigaction action, previous;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = stop_bench;
+    sigaction(SIGINT, &action, &previous);
+    stopping = 0;
+
+    if (status == 0) {
+        printf("bench: %d run%s of %d command%s after %d warmup run%s\n", runs, runs == 1 ? "" : "s", count,
+               count == 1 ? "" : "s", warmup, warmup == 1 ? "" : "s");
+        fflush(stdout);
+    }
+    for (int run = -warmup; run < runs && status == 0 && !stopping; run++) {
+        for (int i = 0; i < total && status == 0 && !stopping; i++) {
+            bench_command *b = &commands[i];
+            if (run_once(b, null_fd, run >= 0 ? &b->samples[run] : NULL) != 0) {
+                printf("Error: 'bench' could not run '%s'.\n", b->text);
+                status = -1;
+            } else if (run >= 0) {
+                b->num_samples++;
+            }
+        }
+    }
+    sigaction(SIGINT, &previous, NULL);
+
+    if (status == 0) {
+        if (stopping) {
+            printf("\nbench: interrupted\n");
+        }
+        for (int i = 0; i < total; i++) {
+            summarize(&commands[i]);
+        }
+        if (total > count && commands[count].summary.kept > 0) {
+            printf("launch overhead: median %.3f ms (spawning 'true'), included in the times below\n",
+                   commands[count].summary.median * 1e3);
+        }
+        for (int i = 0; i < count; i++) {
+            print_summary(&commands[i], i + 1);
+            if (i > 0) {
+                print_speedup(&commands[0], &commands[i], i + 1);
+            }
+        }
+        if (csv_path != NULL && export_csv(csv_path, commands, total) != 0) {
+            status = -1;
+        }
+        if (json_path != NULL && export_json(json_path, commands, total, warmup) != 0) {
+            status = -1;
+        }
+    }
+
+    if (null_fd >= 0) {
+        close(null_fd);
+    }
+    for (int i = 0; i < count + 1; i++) {
+        free(commands[i].samples);
+        free_tokens(commands[i].tokens, commands[i].num_tokens);
+    }
+    free(commands);
+    return status == 0 ? 0 : 1;
+}
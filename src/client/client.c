@@ -0,0 +1,266 @@
+#include "client.h"
+
+// How run_tasks() runs one task
+#define MODE_SERVER 0 // A request to 'myshell --serve'
+#define MODE_FORK 1   // A fresh 'myshell script' process
+
+/* Function: usage
+ * --------------------
+ * Prints how the client is called.
+ */
+static void usage(const char *name) {
+    fprintf(stderr, "Usage: %s SOCKET COMMAND...\n", name);
+    fprintf(stderr, "       %s --bench [-n TASKS] [-c CLIENTS] [--shell MYSHELL] SOCKET COMMAND...\n", name);
+}
+
+/* Function: join_words
+ * --------------------
+ * Joins the command words given on the command line with spaces.
+ *
+ * returns: 0 on success, -1 if the line is too long
+ */
+static int join_words(char **words, int count, char *line, size_t size) {
+    size_t length = 0;
+    line[0] = '\0';
+    for (int i = 0; i < count; i++) {
+        int written = snprintf(line + length, size - length, i ? " %s" : "%s", words[i]);
+        if (written < 0 || (size_t)written >= size - length) {
+            return -1;
+        }
+        length += written;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    int tasks = DEFAULT_BENCH_TASKS;
+    int clients = DEFAULT_BENCH_CLIENTS;
+    const char *shell = "./myshell";
+    int benchmark = 0;
+
+    int next = 1;
+    while (next < argc && argv[next][0] == '-') {
+        if (strcmp(argv[next], "--bench") == 0) {
+            benchmark = 1;
+            next++;
+        } else if (strcmp(argv[next], "-n") == 0 && next + 1 < argc) {
+            tasks = atoi(argv[next + 1]);
+            next += 2;
+        } else if (strcmp(argv[next], "-c") == 0 && next + 1 < argc) {
+            clients = atoi(argv[next + 1]);
+            next += 2;
+        } else if (strcmp(argv[next], "--shell") == 0 && next + 1 < argc) {
+            shell = argv[next + 1];
+            next += 2;
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+
+    char line[MAX_LINE_LENGTH];
+    if (argc - next < 2 || tasks < 1 || clients < 1) {
+        usage(argv[0]);
+        return 2;
+    }
+    if (join_words(argv + next + 1, argc - next - 1, line, sizeof(line)) != 0) {
+        fprintf(stderr, "%s: command too long\n", argv[0]);
+        return 2;
+    }
+
+    if (benchmark) {
+        return bench(argv[next], shell, line, tasks, clients);
+    }
+    int status = send_request(argv[next], line);
+    return status < 0 ? 255 : status;
+}
+
+/* Function: send_request
+ * --------------------
+ * Sends a command line to the server together with this process's stdin,
+ * stdout and stderr, and waits for the exit status. The command's output
+ * goes straight to our stdout and stderr.
+ *
+ * returns: the exit status of the command, -1 if the server failed
+ */
+int send_request(const char *socket_path, const char *line) {
+    struct sockaddr_un address;
+    if (strlen(socket_path) >= sizeof(address.sun_path)) {
+        fprintf(stderr, "myshell-client: socket path too long: %s\n", socket_path);
+        return -1;
+    }
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, socket_path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, (struct sockaddr *)&address, sizeof(address)) != 0) {
+        fprintf(stderr, "myshell-client: cannot connect to %s: %s\n", socket_path, strerror(errno));
+        if (fd >= 0) {
+            close(fd);
+        }
+        return -1;
+    }
+
+    // The header and the line go out in one message, the descriptors with them
+    server_request request = {SERVER_MAGIC, (uint32_t)strlen(line)};
+    struct iovec vectors[2] = {{&request, sizeof(request)}, {(void *)line, request.length}};
+    int fds[SERVER_FDS] = {STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO};
+    char control[CMSG_SPACE(sizeof(fds))];
+    memset(control, 0, sizeof(control));
+    struct msghdr message;
+    memset(&message, 0, sizeof(message));
+    message.msg_iov = vectors;
+    message.msg_iovlen = 2;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+    struct cmsghdr *header = CMSG_FIRSTHDR(&message);
+    header->cmsg_level = SOL_SOCKET;
+    header->cmsg_type = SCM_RIGHTS;
+    header->cmsg_len = CMSG_LEN(sizeof(fds));
+    memcpy(CMSG_DATA(header), fds, sizeof(fds));
+
+    ssize_t sent = sendmsg(fd, &message, 0);
+    if (sent != (ssize_t)(sizeof(request) + request.length)) {
+        fprintf(stderr, "myshell-client: cannot send request: %s\n", sent < 0 ? strerror(errno) : "short write");
+        close(fd);
+        return -1;
+    }
+
+    server_reply reply;
+    size_t length = 0;
+    while (length < sizeof(reply)) {
+        ssize_t received = read(fd, (char *)&reply + length, sizeof(reply) - length);
+        if (received < 0 && errno == EINTR) {
+            continue;
+        }
+        if (received <= 0) {
+            fprintf(stderr, "myshell-client: no reply from %s\n", socket_path);
+            close(fd);
+            return -1;
+        }
+        length += received;
+    }
+    close(fd);
+    return reply.status;
+}
+
+/* Function: fork_task
+ * --------------------
+ * Runs a script in a fresh myshell, the way a task is run without the
+ * server.
+ *
+ * returns: the exit status of the shell, -1 if it could not be started
+ */
+int fork_task(const char *shell, const char *script) {
+    pid_t pid = fork();
+    if (pid == 0) {
+        execl(shell, shell, script, (char *)NULL);
+        _exit(127);
+    }
+    if (pid < 0) {
+        return -1;
+    }
+    int status;
+    while (waitpid(pid, &status, 0) < 0) {
+        if (errno != EINTR) {
+            return -1;
+        }
+    }
+    return WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+}
+
+/* Function: now
+ * --------------------
+ * returns: a monotonic time in seconds
+ */
+static double now(void) {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+/* Function: run_tasks
+ * --------------------
+ * Runs a number of tasks from several client processes at once, each
+ * running its share one after the other. The tasks' output goes to
+ * /dev/null.
+ *
+ * mode: MODE_SERVER or MODE_FORK
+ * target: the socket, or the myshell executable
+ * argument: the command line, or the script holding it
+ * failures: receives the number of tasks that did not exit with 0
+ *
+ * returns: the wall-clock time in seconds, or -1 if a client failed
+ */
+double run_tasks(int mode, const char *target, const char *argument, int tasks, int clients, int *failures) {
+    double start = now();
+    for (int client = 0; client < clients; client++) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            int null = open("/dev/null", O_RDWR);
+            dup2(null, STDIN_FILENO);
+            dup2(null, STDOUT_FILENO);
+            close(null);
+            int share = tasks / clients + (client < tasks % clients);
+            int failed = 0;
+            for (int i = 0; i < share; i++) {
+                int status = mode == MODE_SERVER ? send_request(target, argument) : fork_task(target, argument);
+                if (status < 0) {
+                    _exit(255);
+                }
+                failed += status != 0;
+            }
+            _exit(failed > 254 ? 254 : failed);
+        }
+        if (pid < 0) {
+            perror("fork");
+            return -1;
+        }
+    }
+
+    *failures = 0;
+    int broken = 0;
+    int status;
+    while (wait(&status) > 0) {
+        int code = WIFEXITED(status) ? WEXITSTATUS(status) : 255;
+        broken |= code == 255;
+        *failures += code == 255 ? 0 : code;
+    }
+    double elapsed = now() - start;
+    return broken ? -1 : elapsed;
+}
+
+/* Function: bench
+ * --------------------
+ * Compares the throughput of the server with starting one myshell per
+ * task, for the same command line, number of tasks and concurrency.
+ *
+ * returns: 0 on success, 1 if a run failed
+ */
+int bench(const char *socket_path, const char *shell, const char *line, int tasks, int clients) {
+    char script[] = "/tmp/myshell-bench-XXXXXX";
+    int fd = mkstemp(script);
+    if (fd < 0) {
+        perror("mkstemp");
+        return 1;
+    }
+    dprintf(fd, "%s\n", line);
+    close(fd);
+
+    int failures[2];
+    double server = run_tasks(MODE_SERVER, socket_path, line, tasks, clients, &failures[0]);
+    double forked = run_tasks(MODE_FORK, shell, script, tasks, clients, &failures[1]);
+    unlink(script);
+    if (server < 0 || forked < 0) {
+        fprintf(stderr, "myshell-client: benchmark failed, is '%s' served and '%s' executable?\n", socket_path,
+                shell);
+        return 1;
+    }
+
+    printf("%d tasks of '%s', %d clients\n", tasks, line, clients);
+    printf("server:        %8.3f s  %10.1f tasks/s  (%d failed)\n", server, tasks / server, failures[0]);
+    printf("fork-per-task: %8.3f s  %10.1f tasks/s  (%d failed)\n", forked, tasks / forked, failures[1]);
+    printf("speedup:       %8.2fx\n", forked / server);
+    return 0;
+}
@@ -0,0 +1,21 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../../lib/server.h"
+
+#define MAX_LINE_LENGTH 512
+#define DEFAULT_BENCH_TASKS 1000
+#define DEFAULT_BENCH_CLIENTS 4
+
+int send_request(const char *socket_path, const char *line);
+int fork_task(const char *shell, const char *script);
+double run_tasks(int mode, const char *target, const char *argument, int tasks, int clients, int *failures);
+int bench(const char *socket_path, const char *shell, const char *line, int tasks, int clients);
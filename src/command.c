@@ -3,6 +3,11 @@
 #include <string.h>
 
 #include "../lib/command.h"
+#include "../lib/launch.h"
+
+// Commands handled by the shell itself, NULL terminated
+const char *builtin_names[] = {"alias", "bench",    "exit", "filters", "jobs",    "limit",
+                               "nice",  "perfstat", "pin",  "source",  "timeout", "watch", NULL};
 
 /* Function: parse_command
  * -----------------------
@@ -19,6 +24,13 @@ command parse_command(char *tokens[], int tokenCount) {
     cmd.num_arguments = 0;
     cmd.background = 0;
     cmd.redirect = NO_REDIRECT;
+    cmd.output_file = NULL;
+    cmd.num_tee_files = 0;
+    cmd.input = NO_INPUT;
+    cmd.input_source = NULL;
+    cmd.document = NULL;
+    memset(cmd.arguments, 0, sizeof(cmd.arguments)); // Always NULL terminated
+    memset(&cmd.launch, 0, sizeof(cmd.launch));
 
     // Early exit for empty command
     if (tokenCount == 0) {
@@ -26,11 +38,74 @@ command parse_command(char *tokens[], int tokenCount) {
         return cmd;
     }
 
+    // Consume prefix builtins that only change how the command is launched
+    int start = 0;
+    while (start < tokenCount) {
+        if (strcmp(tokens[start], "timeout") == 0) {
+            char *end = NULL;
+            double seconds = start + 2 < tokenCount ? strtod(tokens[start + 1], &end) : 0;
+            if (end == NULL || *end != '\0' || seconds <= 0) {
+                cmd.op = INVALID;
+                cmd.arguments[cmd.num_arguments++] = tokens[start];
+                return cmd;
+            }
+            cmd.launch.timeout = seconds;
+            start += 2;
+        } else if (strcmp(tokens[start], "pin") == 0) {
+            if (start + 2 >= tokenCount || parse_cpu_list(tokens[start + 1], &cmd.launch) != 0) {
+                cmd.op = INVALID;
+                cmd.arguments[cmd.num_arguments++] = tokens[start];
+                return cmd;
+            }
+            start += 2;
+        } else if (strcmp(tokens[start], "nice") == 0 && start + 2 < tokenCount &&
+                   parse_nice(tokens[start + 1], &cmd.launch) == 0) {
+            // Other forms, such as 'nice -n N cmd', are left to nice(1)
+            start += 2;
+        } else if (strcmp(tokens[start], "limit") == 0) {
+            int next = start + 1;
+            while (next < tokenCount - 1 && strchr(tokens[next], '=') != NULL) {
+                if (parse_limit(tokens[next], &cmd.launch) != 0) {
+                    break;
+                }
+                next++;
+            }
+            if (next == start + 1 || strchr(tokens[next], '=') != NULL) {
+                cmd.op = INVALID;
+                cmd.arguments[cmd.num_arguments++] = tokens[start];
+                return cmd;
+            }
+            start = next;
+        } else if (strcmp(tokens[start], "perfstat") == 0) {
+            if (start + 1 >= tokenCount) {
+                cmd.op = INVALID;
+                cmd.arguments[cmd.num_arguments++] = tokens[start];
+                return cmd;
+            }
+            cmd.launch.perfstat = 1;
+            start++;
+        } else {
+            break;
+        }
+    }
+    tokens += start;
+    tokenCount -= start;
+
     // Handle special commands
     if (strcmp(tokens[0], "exit") == 0) {
         cmd.op = EXIT;
     } else if (strcmp(tokens[0], "alias") == 0) {
         cmd.op = ALIAS;
+    } else if (strcmp(tokens[0], "source") == 0) {
+        cmd.op = SOURCE;
+    } else if (strcmp(tokens[0], "jobs") == 0) {
+        cmd.op = JOBS;
+    } else if (strcmp(tokens[0], "filters") == 0) {
+        cmd.op = FILTERS;
+    } else if (strcmp(tokens[0], "watch") == 0) {
+        cmd.op = WATCH;
+    } else if (strcmp(tokens[0], "bench") == 0) {
+        cmd.op = BENCH;
     }
 
     // Parse arguments and check for background/redirect flags
@@ -40,6 +115,37 @@ command parse_command(char *tokens[], int tokenCount) {
             continue; // Skip the '&' token
         }
 
+        // Input redirections, '<<DELIMITER' may be written as one word
+        if (i < tokenCount - 1 && (strcmp(tokens[i], "<") == 0 || strcmp(tokens[i], "<<<") == 0 ||
+                                   strcmp(tokens[i], "<<") == 0)) {
+            if (strcmp(tokens[i], "<") == 0) {
+                cmd.input = INPUT_FILE;
+            } else if (strcmp(tokens[i], "<<<") == 0) {
+                cmd.input = HERE_STRING;
+            } else {
+                cmd.input = HERE_DOCUMENT;
+            }
+            cmd.input_source = tokens[++i];
+            continue;
+        }
+        if (strncmp(tokens[i], "<<", 2) == 0 && tokens[i][2] != '\0' && tokens[i][2] != '<') {
+            cmd.input = HERE_DOCUMENT;
+            cmd.input_source = tokens[i] + 2;
+            continue;
+        }
+
+        // '>|' may be repeated, every target receives the whole output
+        if (i < tokenCount - 1 && strcmp(tokens[i], ">|") == 0) {
+            if (cmd.num_tee_files == MAX_TEE_TARGETS) {
+                cmd.op = INVALID;
+                cmd.arguments[0] = tokens[i];
+                cmd.num_arguments = 1;
+                return cmd;
+            }
+            cmd.tee_files[cmd.num_tee_files++] = tokens[++i];
+            continue;
+        }
+
         // Check and handle redirection operators
         if (i < tokenCount - 1 &&
             (strcmp(tokens[i], ">") == 0 || strcmp(tokens[i], ">>") == 0 ||
@@ -52,7 +158,7 @@ command parse_command(char *tokens[], int tokenCount) {
             } else if (strcmp(tokens[i], ">>>") == 0) {
                 cmd.redirect = REVERSE;
             }
-            i++; // Skip the next token (filename for redirection)
+            cmd.output_file = tokens[++i]; // The next token is the filename
             continue;
         }
 
@@ -60,9 +166,96 @@ command parse_command(char *tokens[], int tokenCount) {
         cmd.arguments[cmd.num_arguments++] = tokens[i];
     }
 
+    // Redirections or '&' without a command, such as '> x'
+    if (cmd.num_arguments == 0) {
+        cmd.op = INVALID;
+        cmd.arguments[0] = tokens[0];
+        cmd.num_arguments = 1;
+    }
+
+    // A command has a single stdout, it cannot go to '>|' and '>' at once
+    if (cmd.num_tee_files > 0 && cmd.redirect != NO_REDIRECT) {
+        cmd.op = INVALID;
+        cmd.arguments[0] = ">|";
+        cmd.num_arguments = 1;
+    }
+
+    // The counters are read when the shell has waited for the command
+    if (cmd.launch.perfstat && cmd.background) {
+        cmd.op = INVALID;
+        cmd.arguments[0] = "perfstat";
+        cmd.num_arguments = 1;
+    }
+
     return cmd;
 }
 
+/* Function: is_chain_operator
+ * --------------------
+ * returns: 1 if a token is ';', '&&' or '||', 0 otherwise
+ */
+int is_chain_operator(const char *token) {
+    return strcmp(token, ";") == 0 || strcmp(token, "&&") == 0 || strcmp(token, "||") == 0;
+}
+
+/* Function: split_chain
+ * --------------------
+ * Splits the tokens of a line at unquoted ';', '&&' and '||' into the
+ * commands of a chain. Empty commands after ';' are dropped, so a line may
+ * end in ';'.
+ *
+ * tokens: the tokens of the line
+ * quoted: the quote flags of the tokens, or NULL
+ * tokenCount: the number of tokens
+ * links: the array to store the commands in, with room for tokenCount
+ * error: set to the offending operator on a syntax error
+ *
+ * returns: the number of commands, or -1 if an operator has no command on
+ * one of its sides
+ */
+int split_chain(char *tokens[], const int quoted[], int tokenCount, chain_link links[], const char **error) {
+    int count = 0;
+    int start = 0;
+    connector next = CHAIN_ALWAYS;
+
+    for (int i = 0; i <= tokenCount; i++) {
+        int end = i == tokenCount || ((quoted == NULL || !quoted[i]) && is_chain_operator(tokens[i]));
+        if (!end) {
+            continue;
+        }
+
+        if (i > start) {
+            links[count].start = start;
+            links[count].count = i - start;
+            links[count].connector = next;
+            count++;
+        } else if (next != CHAIN_ALWAYS || (i < tokenCount && strcmp(tokens[i], ";") != 0)) {
+            // '&&' and '||' need a command on both sides
+            *error = i < tokenCount ? tokens[i] : tokens[i - 1];
+            return -1;
+        }
+
+        if (i < tokenCount) {
+            next = strcmp(tokens[i], "&&") == 0 ? CHAIN_AND : strcmp(tokens[i], "||") == 0 ? CHAIN_OR : CHAIN_ALWAYS;
+        }
+        start = i + 1;
+    }
+
+    return count;
+}
+
+/* Function: link_runs
+ * --------------------
+ * Decides whether a command of a chain runs, given the exit status of the
+ * last command that ran. Skipped commands leave that status unchanged, so
+ * 'false && a || b' runs b.
+ *
+ * returns: 1 if the command runs, 0 if it is skipped
+ */
+int link_runs(connector connector, int status) {
+    return connector == CHAIN_ALWAYS || (connector == CHAIN_AND) == (status == 0);
+}
+
 /* Function: print_command
  * -----------------------
  * Prints the contents of a command struct.
@@ -77,4 +270,35 @@ void print_command(command cmd) {
     }
     printf("\nBackground: %d\n", cmd.background);
     printf("Redirect: %d\n", cmd.redirect);
+    if (cmd.output_file) {
+        printf("Output File: %s\n", cmd.output_file);
+    }
+    if (cmd.input_source) {
+        printf("Input (%d): %s\n", cmd.input, cmd.input_source);
+    }
+    for (int i = 0; i < cmd.num_tee_files; ++i) {
+        printf("Tee File: %s\n", cmd.tee_files[i]);
+    }
+    if (cmd.launch.timeout > 0) {
+        printf("Timeout: %g\n", cmd.launch.timeout);
+    }
+    if (cmd.launch.pinned) {
+        printf("Pinned CPUs:");
+        for (int cpu = 0; cpu < MAX_PINNED_CPUS; ++cpu) {
+            if (cmd.launch.cpus[cpu / 8] & (1 << (cpu % 8))) {
+                printf(" %d", cpu);
+            }
+        }
+        printf("\n");
+    }
+    if (cmd.launch.niced) {
+        printf("Nice: %d\n", cmd.launch.nice);
+    }
+    if (cmd.launch.memory_limit > 0 || cmd.launch.cpu_limit > 0 || cmd.launch.file_limit > 0) {
+        printf("Limits: mem=%lld cpu=%lld files=%lld\n", cmd.launch.memory_limit, cmd.launch.cpu_limit,
+               cmd.launch.file_limit);
+    }
+    if (cmd.launch.perfstat) {
+        printf("Perfstat: on\n");
+    }
 }
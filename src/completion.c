@@ -0,0 +1,432 @@
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../lib/command.h"
+#include "../lib/completion.h"
+#include "../lib/dirscan.h"
+
+/* The executables of one PATH directory, as of its last modification time.
+ * Names point into the directory listing. */
+typedef struct path_directory {
+    char *path;
+    struct timespec mtime;
+    directory_listing listing;
+    char **executables;
+    int count;
+} path_directory;
+
+// Owned by the index thread
+static path_directory *directories[MAX_PATH_DIRECTORIES];
+static int num_directories = 0;
+
+// Shared with the shell, guarded by index_lock
+static pthread_mutex_t index_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t refresh_wanted = PTHREAD_COND_INITIALIZER;
+static char *requested_path = NULL;
+static int started = 0;
+static char **index_names = NULL; // Sorted, without duplicates
+static int index_count = 0;
+
+/* Function: compare_names
+ * --------------------
+ * qsort() comparator for arrays of strings.
+ */
+static int compare_names(const void *a, const void *b) {
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+/* Function: free_directory
+ * --------------------
+ * Releases a scanned PATH directory.
+ */
+static void free_directory(path_directory *dir) {
+    if (dir == NULL) {
+        return;
+    }
+    free_directory_listing(&dir->listing);
+    free(dir->executables);
+    free(dir->path);
+    free(dir);
+}
+
+/* Function: scan_directory
+ * --------------------
+ * Lists a PATH directory and keeps the entries that are executable files.
+ *
+ * path: the directory
+ * previous: the last scan of the same directory, or NULL
+ * changed: set to 1 if the directory had to be scanned again
+ *
+ * returns: previous if the directory did not change since it was scanned, a
+ * new scan otherwise, or NULL if the directory cannot be read
+ */
+static path_directory *scan_directory(const char *path, path_directory *previous, int *changed) {
+    int fd = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) {
+        *changed |= previous != NULL;
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        *changed |= previous != NULL;
+        return NULL;
+    }
+    struct timespec mtime = stat_mtime(&st);
+    if (previous != NULL && previous->mtime.tv_sec == mtime.tv_sec &&
+        previous->mtime.tv_nsec == mtime.tv_nsec) {
+        close(fd);
+        return previous;
+    }
+
+    path_directory *dir = calloc(1, sizeof(path_directory));
+    if (dir == NULL) {
+        close(fd);
+        return previous;
+    }
+    dir->path = strdup(path);
+    dir->mtime = mtime;
+
+    if (list_directory(fd, &dir->listing) < 0) {
+        close(fd);
+        free_directory(dir);
+        return previous;
+    }
+    dir->executables = malloc((dir->listing.count + 1) * sizeof(char *));
+    if (dir->executables == NULL) {
+        close(fd);
+        free_directory(dir);
+        return previous;
+    }
+
+    for (int i = 0; i < dir->listing.count; i++) {
+        char *name = dir->listing.names[i];
+        unsigned char type = dir->listing.types[i];
+        if (type == DT_DIR) {
+            continue;
+        }
+        if (type != DT_REG) {
+            // Symbolic links and unknown types need a stat to tell files apart
+            struct stat entry_st;
+            if (fstatat(fd, name, &entry_st, 0) != 0 || !S_ISREG(entry_st.st_mode)) {
+                continue;
+            }
+        }
+        if (faccessat(fd, name, X_OK, 0) == 0) {
+            dir->executables[dir->count++] = name;
+        }
+    }
+
+    close(fd);
+    *changed = 1;
+    return dir;
+}
+
+/* Function: rebuild_index
+ * --------------------
+ * Brings the index up to date with the directories of a PATH value. Only
+ * directories whose mtime changed since the last rebuild are scanned again,
+ * and the index is replaced only if something changed.
+ */
+static void rebuild_index(const char *path) {
+    path_directory *updated[MAX_PATH_DIRECTORIES];
+    int fresh[MAX_PATH_DIRECTORIES];
+    int num_updated = 0;
+    int changed = 0;
+    int reused[MAX_PATH_DIRECTORIES] = {0};
+
+    char *pathCopy = strdup(path);
+    if (pathCopy == NULL) {
+        return;
+    }
+    for (char *dir = strtok(pathCopy, ":"); dir != NULL && num_updated < MAX_PATH_DIRECTORIES; dir = strtok(NULL, ":")) {
+        int duplicate = 0;
+        for (int i = 0; i < num_updated; i++) {
+            duplicate |= strcmp(updated[i]->path, dir) == 0;
+        }
+        if (duplicate) {
+            continue;
+        }
+
+        int previous = -1;
+        for (int i = 0; i < num_directories; i++) {
+            if (!reused[i] && strcmp(directories[i]->path, dir) == 0) {
+                previous = i;
+                break;
+            }
+        }
+
+        path_directory *scanned = scan_directory(dir, previous >= 0 ? directories[previous] : NULL, &changed);
+        if (previous >= 0 && scanned == directories[previous]) {
+            reused[previous] = 1;
+        }
+        if (scanned != NULL) {
+            fresh[num_updated] = previous < 0 || scanned != directories[previous];
+            updated[num_updated++] = scanned;
+        }
+    }
+    free(pathCopy);
+
+    if (num_updated != num_directories) {
+        changed = 1;
+    }
+    if (!changed) {
+        return;
+    }
+
+    // Merge builtins and every directory into one sorted array
+    int total = 0;
+    for (int i = 0; builtin_names[i] != NULL; i++) {
+        total++;
+    }
+    for (int i = 0; i < num_updated; i++) {
+        total += updated[i]->count;
+    }
+    char **names = malloc((total + 1) * sizeof(char *));
+    if (names == NULL) {
+        for (int i = 0; i < num_updated; i++) {
+            if (fresh[i]) {
+                free_directory(updated[i]);
+            }
+        }
+        return;
+    }
+    int count = 0;
+    for (int i = 0; builtin_names[i] != NULL; i++) {
+        names[count++] = (char *)builtin_names[i];
+    }
+    for (int i = 0; i < num_updated; i++) {
+        memcpy(names + count, updated[i]->executables, updated[i]->count * sizeof(char *));
+        count += updated[i]->count;
+    }
+    qsort(names, count, sizeof(char *), compare_names);
+
+    int unique = 0;
+    for (int i = 0; i < count; i++) {
+        if (unique == 0 || strcmp(names[unique - 1], names[i]) != 0) {
+            names[unique++] = names[i];
+        }
+    }
+
+    // Publish the new index, then release what it no longer refers to
+    pthread_mutex_lock(&index_lock);
+    char **old_names = index_names;
+    index_names = names;
+    index_count = unique;
+    pthread_mutex_unlock(&index_lock);
+
+    free(old_names);
+    for (int i = 0; i < num_directories; i++) {
+        if (!reused[i]) {
+            free_directory(directories[i]);
+        }
+    }
+    memcpy(directories, updated, num_updated * sizeof(path_directory *));
+    num_directories = num_updated;
+}
+
+/* Function: index_thread
+ * --------------------
+ * Background thread that rebuilds the index whenever a refresh is
+ * requested, so that scanning PATH never delays the prompt.
+ */
+static void *index_thread(void *arg) {
+    (void)arg;
+    while (1) {
+        pthread_mutex_lock(&index_lock);
+        while (requested_path == NULL) {
+            pthread_cond_wait(&refresh_wanted, &index_lock);
+        }
+        char *path = requested_path;
+        requested_path = NULL;
+        pthread_mutex_unlock(&index_lock);
+
+        rebuild_index(path);
+        free(path);
+    }
+    return NULL;
+}
+
+/* Function: refresh_completion_index
+ * --------------------
+ * Asks the index thread to pick up changes of PATH and of its directories.
+ * Returns immediately; lookups keep using the current index meanwhile.
+ */
+void refresh_completion_index(void) {
+    char *path = getenv("PATH");
+    if (path == NULL) {
+        return;
+    }
+    char *copy = strdup(path);
+    if (copy == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&index_lock);
+    free(requested_path);
+    requested_path = copy;
+    pthread_cond_signal(&refresh_wanted);
+    pthread_mutex_unlock(&index_lock);
+}
+
+/* Function: start_completion_index
+ * --------------------
+ * Starts the background thread that indexes the executables in PATH and
+ * requests the first build. Calling it again has no effect.
+ */
+void start_completion_index(void) {
+    if (started) {
+        return;
+    }
+    started = 1;
+
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, index_thread, NULL) != 0) {
+        return;
+    }
+    pthread_detach(thread);
+    refresh_completion_index();
+}
+
+/* Function: lower_bound
+ * --------------------
+ * Binary search for the first name that is not less than key in its first
+ * length characters.
+ */
+static int lower_bound(char **names, int count, const char *key, size_t length) {
+    int low = 0, high = count;
+    while (low < high) {
+        int mid = low + (high - low) / 2;
+        if (strncmp(names[mid], key, length) < 0) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+/* Function: upper_bound
+ * --------------------
+ * Binary search for the first name that is greater than key in its first
+ * length characters.
+ */
+static int upper_bound(char **names, int count, const char *key, size_t length) {
+    int low = 0, high = count;
+    while (low < high) {
+        int mid = low + (high - low) / 2;
+        if (strncmp(names[mid], key, length) <= 0) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+/* Function: add_match
+ * --------------------
+ * Records one matching name in a completion result.
+ */
+static void add_match(completion_result *result, const char *name) {
+    if (result->count == 0) {
+        snprintf(result->common, sizeof(result->common), "%s", name);
+    } else {
+        size_t i = 0;
+        while (result->common[i] && result->common[i] == name[i]) {
+            i++;
+        }
+        result->common[i] = '\0';
+    }
+    if (result->num_listed < MAX_LISTED_COMPLETIONS) {
+        result->listed[result->num_listed++] = strdup(name);
+    }
+    result->count++;
+}
+
+/* Function: complete_command
+ * --------------------
+ * Finds the builtins, aliases and PATH executables starting with a prefix.
+ * Executables are looked up with two binary searches over the sorted index,
+ * so the cost does not grow with the number of executables in PATH; only
+ * the matches that are listed get copied.
+ *
+ * prefix: the beginning of a command name
+ * result: receives the matches; release it with free_completion_result()
+ *
+ * returns: the number of matches
+ */
+int complete_command(const char *prefix, completion_result *result) {
+    size_t length = strlen(prefix);
+    result->count = 0;
+    result->num_listed = 0;
+    result->common[0] = '\0';
+
+    pthread_mutex_lock(&index_lock);
+    if (index_count == 0) {
+        // Not indexed yet, builtins are always available
+        for (int i = 0; builtin_names[i] != NULL; i++) {
+            if (strncmp(builtin_names[i], prefix, length) == 0) {
+                add_match(result, builtin_names[i]);
+            }
+        }
+    } else {
+        int first = lower_bound(index_names, index_count, prefix, length);
+        int last = upper_bound(index_names, index_count, prefix, length);
+        if (first < last) {
+            // The names are sorted, so the first and last match bound the common prefix
+            const char *a = index_names[first];
+            const char *b = index_names[last - 1];
+            size_t common = 0;
+            while (a[common] && a[common] == b[common] && common < sizeof(result->common) - 1) {
+                common++;
+            }
+            memcpy(result->common, a, common);
+            result->common[common] = '\0';
+
+            for (int i = first; i < last && result->num_listed < MAX_LISTED_COMPLETIONS; i++) {
+                result->listed[result->num_listed++] = strdup(index_names[i]);
+            }
+            result->count = last - first;
+        }
+    }
+    pthread_mutex_unlock(&index_lock);
+
+    // Aliases change at any time and are few, so they are read directly
+    FILE *file = fopen(".aliases", "r");
+    if (file != NULL) {
+        char line[MAX_INPUT_LENGTH];
+        while (fgets(line, sizeof(line), file)) {
+            char name[MAX_INPUT_LENGTH];
+            if (sscanf(line, "%511s =", name) == 1 && strncmp(name, prefix, length) == 0) {
+                int duplicate = 0;
+                for (int i = 0; i < result->num_listed; i++) {
+                    duplicate |= strcmp(result->listed[i], name) == 0;
+                }
+                if (!duplicate) {
+                    add_match(result, name);
+                }
+            }
+        }
+        fclose(file);
+    }
+
+    return result->count;
+}
+
+/* Function: free_completion_result
+ * --------------------
+ * Releases the names listed in a completion result.
+ */
+void free_completion_result(completion_result *result) {
+    for (int i = 0; i < result->num_listed; i++) {
+        free(result->listed[i]);
+    }
+    result->num_listed = 0;
+}
@@ -0,0 +1,152 @@
+#include <dirent.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+#include "../lib/dirscan.h"
+
+#ifdef __linux__
+// Record layout returned by the getdents64 system call
+struct linux_dirent64 {
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+#endif
+
+/* Function: add_entry
+ * --------------------
+ * Appends a name to a directory listing, growing its arrays as needed.
+ *
+ * returns: 0 on success, 1 if allocation failed
+ */
+static int add_entry(directory_listing *listing, char *name, unsigned char type) {
+    if (listing->count == listing->capacity) {
+        int capacity = listing->capacity ? listing->capacity * 2 : 256;
+        char **names = realloc(listing->names, capacity * sizeof(char *));
+        if (names == NULL) {
+            return 1;
+        }
+        listing->names = names;
+        unsigned char *types = realloc(listing->types, capacity);
+        if (types == NULL) {
+            return 1;
+        }
+        listing->types = types;
+        listing->capacity = capacity;
+    }
+    listing->names[listing->count] = name;
+    listing->types[listing->count] = type;
+    listing->count++;
+    return 0;
+}
+
+/* Function: list_directory
+ * --------------------
+ * Reads every entry of a directory except "." and "..". On Linux the
+ * entries are read with getdents64 straight into buffers of the listing's
+ * arena and the names are used in place, so listing a large directory costs
+ * one system call per DIRSCAN_BUFFER_SIZE bytes of entries and no string
+ * copies. Elsewhere readdir() is used.
+ *
+ * dirfd: an open file descriptor of the directory, read from its current
+ * offset. It is not closed.
+ * listing: the listing to fill (zero-initialized before first use)
+ *
+ * returns: the number of entries read, or -1 on error
+ */
+int list_directory(int dirfd, directory_listing *listing) {
+#ifdef __linux__
+    // Start small so that short directories do not pin large buffers
+    size_t buffer_size = 8192;
+    while (1) {
+        char *buffer = arena_alloc(&listing->strings, buffer_size);
+        if (buffer == NULL) {
+            return -1;
+        }
+
+        long num_read = syscall(SYS_getdents64, dirfd, buffer, buffer_size);
+        if (num_read < 0) {
+            return -1;
+        }
+        if (num_read == 0) {
+            break;
+        }
+
+        for (long offset = 0; offset < num_read;) {
+            struct linux_dirent64 *entry = (struct linux_dirent64 *)(buffer + offset);
+            offset += entry->d_reclen;
+
+            char *name = entry->d_name;
+            if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) {
+                continue;
+            }
+            if (add_entry(listing, name, entry->d_type) != 0) {
+                return -1;
+            }
+        }
+        if (buffer_size < DIRSCAN_BUFFER_SIZE) {
+            buffer_size *= 2;
+        }
+    }
+#else
+    int fd = dup(dirfd);
+    DIR *dir = fd >= 0 ? fdopendir(fd) : NULL;
+    if (dir == NULL) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        return -1;
+    }
+
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        char *name = entry->d_name;
+        if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) {
+            continue;
+        }
+        char *copy = arena_strdup(&listing->strings, name);
+        if (copy == NULL || add_entry(listing, copy, entry->d_type) != 0) {
+            closedir(dir);
+            return -1;
+        }
+    }
+    closedir(dir);
+#endif
+
+    return listing->count;
+}
+
+/* Function: free_directory_listing
+ * --------------------
+ * Releases the names and arrays of a directory listing.
+ */
+void free_directory_listing(directory_listing *listing) {
+    arena_free(&listing->strings);
+    free(listing->names);
+    free(listing->types);
+    listing->names = NULL;
+    listing->types = NULL;
+    listing->count = 0;
+    listing->capacity = 0;
+}
+
+/* Function: stat_mtime
+ * --------------------
+ * Extracts the nanosecond modification time from a stat struct.
+ */
+struct timespec stat_mtime(const struct stat *st) {
+#ifdef __APPLE__
+    return st->st_mtimespec;
+#else
+    return st->st_mtim;
+#endif
+}
@@ -0,0 +1,674 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "../lib/alias.h"
+#include "../lib/bench.h"
+#include "../lib/executor.h"
+#include "../lib/filters.h"
+#include "../lib/jobs.h"
+#include "../lib/launch.h"
+#include "../lib/perfstat.h"
+#include "../lib/redirect.h"
+#include "../lib/script.h"
+#include "../lib/substitute.h"
+#include "../lib/tokenize.h"
+#include "../lib/watch.h"
+#include "../lib/wildcard.h"
+
+/* Function: find_executable
+ * --------------------
+ * Finds the full path to an executable in the PATH environment variable.
+ *
+ * command: The command to be searched for.
+ *
+ * returns: The full path to the executable if found, NULL otherwise.
+ */
+char *find_executable(char *command) {
+    char *path = getenv("PATH");
+    char *pathCopy = strdup(path);
+    char *dir = strtok(pathCopy, ":");
+    static char fullPath[MAX_PATH_LENGTH];
+
+    while (dir != NULL) {
+        snprintf(fullPath, sizeof(fullPath), "%s/%s", dir, command);
+        if (access(fullPath, X_OK) == 0) {
+            free(pathCopy);
+            return fullPath;
+        }
+        dir = strtok(NULL, ":");
+    }
+
+    free(pathCopy);
+    return NULL;
+}
+
+/* Function: spawn_command
+ * --------------------
+ * Runs an external command in a child process, applying its input and
+ * output redirections. The child is handed to the job supervisor: foreground
+ * commands are waited for through its event loop, background commands are
+ * left running (with their output captured if 'jobs -c on' is set).
+ *
+ * cmd: The parsed command. Its arguments array is null-terminated here.
+ * executable_path: The resolved path of the executable.
+ * stdio: descriptors for the child's stdin and stdout (pipeline stages),
+ * -1 to inherit; redirections of the command take precedence. May be NULL.
+ * started: if not NULL, the job is stored here (NULL if it could not be
+ * supervised) and the command is not waited for
+ *
+ * returns: The exit status of a foreground command (124 if it timed out),
+ * 0 for background and started commands, and 1 if the child could not be
+ * created.
+ */
+int spawn_command(command *cmd, const char *executable_path, const int stdio[2], job **started) {
+    // Ensure the arguments array is null-terminated
+    cmd->arguments[cmd->num_arguments] = NULL;
+
+    // Open the command's stdin before forking, so errors need no child
+    int input_fd = -1;
+    if (cmd->input != NO_INPUT) {
+        input_fd = open_input(cmd);
+        if (input_fd < 0) {
+            return 1;
+        }
+    }
+
+    // Background jobs can have their stdout and stderr captured into pipes
+    int capture = cmd->background && output_capture_enabled();
+    int capture_pipes[2][2];
+    if (capture) {
+        if (pipe(capture_pipes[0]) == -1) {
+            perror("pipe");
+            if (input_fd >= 0) {
+                close(input_fd);
+            }
+            return 1;
+        }
+        if (pipe(capture_pipes[1]) == -1) {
+            perror("pipe");
+            close(capture_pipes[0][0]);
+            close(capture_pipes[0][1]);
+            if (input_fd >= 0) {
+                close(input_fd);
+            }
+            return 1;
+        }
+        for (int i = 0; i < 2; i++) {
+            fcntl(capture_pipes[i][0], F_SETFD, FD_CLOEXEC);
+            fcntl(capture_pipes[i][0], F_SETFL, O_NONBLOCK);
+        }
+    }
+
+    // Several '>|' targets are fed by the supervisor from a pipe
+    tee_relay *tee = NULL;
+    int tee_pipe[2] = {-1, -1};
+    if (cmd->num_tee_files > 1) {
+        if (pipe(tee_pipe) == -1) {
+            perror("pipe");
+            tee_pipe[0] = tee_pipe[1] = -1;
+        } else {
+            fcntl(tee_pipe[0], F_SETFD, FD_CLOEXEC);
+            tee = create_tee_relay(tee_pipe[0], cmd->tee_files, cmd->num_tee_files);
+        }
+        if (tee == NULL) {
+            if (tee_pipe[1] >= 0) {
+                close(tee_pipe[1]);
+            }
+            if (capture) {
+                for (int i = 0; i < 2; i++) {
+                    close(capture_pipes[i][0]);
+                    close(capture_pipes[i][1]);
+                }
+            }
+            if (input_fd >= 0) {
+                close(input_fd);
+            }
+            return 1;
+        }
+    }
+
+    // Background jobs may take the next CPU of the session's round-robin
+    launch_options launch = cmd->launch;
+    if (cmd->background) {
+        assign_job_cpu(&launch);
+    }
+
+    // 'perfstat' counters are opened on the child while it waits on this pipe
+    int measure = launch.perfstat && !cmd->background && started == NULL;
+    int release_pipe[2] = {-1, -1};
+    if (measure && pipe(release_pipe) == -1) {
+        perror("pipe");
+        measure = 0; // Run the command without counters
+    }
+
+    // Do not let the child inherit (and flush again) pending output
+    fflush(stdout);
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        // Child process
+        char *output_file = cmd->output_file;
+
+        if (measure) {
+            char byte;
+            close(release_pipe[1]);
+            while (read(release_pipe[0], &byte, 1) < 0 && errno == EINTR) {
+            }
+            close(release_pipe[0]);
+        }
+
+        // Affinity, priority and limits are inherited by execv()
+        apply_launch_options(&launch);
+
+        if (input_fd >= 0) {
+            dup2(input_fd, STDIN_FILENO);
+            close(input_fd);
+        }
+
+        if (capture) {
+            dup2(capture_pipes[0][1], STDOUT_FILENO);
+            dup2(capture_pipes[1][1], STDERR_FILENO);
+            for (int i = 0; i < 2; i++) {
+                close(capture_pipes[i][0]);
+                close(capture_pipes[i][1]);
+            }
+        }
+
+        // Pipeline stages read from and write to their neighbours
+        if (stdio != NULL && stdio[0] >= 0 && input_fd < 0) {
+            dup2(stdio[0], STDIN_FILENO);
+        }
+        if (stdio != NULL && stdio[1] >= 0) {
+            dup2(stdio[1], STDOUT_FILENO);
+        }
+
+        // If the command is to be redirected to a file
+        if (output_file != NULL) {
+            if (cmd->redirect == OUTPUT || cmd->redirect == APPEND) {
+                int fd = open_output_file(output_file, cmd->redirect);
+                if (fd < 0) {
+                    printf("Error: Unable to open file %s for redirecting.\n", output_file);
+                    fflush(stdout);
+                    _exit(1);
+                }
+
+                // Redirect stdout to the file
+                dup2(fd, STDOUT_FILENO);
+                close(fd);
+            } else if (cmd->redirect == REVERSE) {
+                // We need pipes and subchildren for this to reverse the output from execv()
+                int pipefd[2];
+                // handle error on pipe creation
+                if (pipe(pipefd) == -1) {
+                    perror("pipe");
+                    _exit(EXIT_FAILURE);
+                }
+                pid_t pid2;
+                pid2 = fork();
+                if (pid2 == 0) {
+                    // Child process
+                    close(pipefd[0]); // Close unused read end
+                    dup2(pipefd[1], STDOUT_FILENO);
+                    close(pipefd[1]); // Close write end
+                    execv(executable_path, cmd->arguments);
+                    _exit(EXIT_FAILURE);
+                } else if (pid2 > 0) {
+                    // Parent process
+                    // We will invert the output from the child process and then redirect it to the file
+                    close(pipefd[1]); // Close unused write end
+                    char tmp[MAX_INPUT_LENGTH];
+                    ssize_t num_read;
+                    num_read = read(pipefd[0], tmp, MAX_INPUT_LENGTH - 1);
+                    if (num_read == -1) {
+                        perror("read");
+                        _exit(EXIT_FAILURE);
+                    }
+                    tmp[num_read] = '\0';
+
+                    // Invert the output string
+                    // i.e. "Hello World" becomes "dlroW olleH"
+
+                    int fd = open_output_file(output_file, APPEND);
+                    if (fd < 0) {
+                        printf("Error: Unable to open file %s for redirecting.\n", output_file);
+                        fflush(stdout);
+                        _exit(1);
+                    }
+                    size_t length = strlen(tmp);
+                    for (size_t i = 0; i < length / 2; i++) {
+                        char c = tmp[i];
+                        tmp[i] = tmp[length - 1 - i];
+                        tmp[length - 1 - i] = c;
+                    }
+                    if (write(fd, tmp, length) < 0) {
+                        perror("write");
+                    }
+                    close(fd);
+
+                    _exit(0);
+
+                } else {
+                    perror("Fork failed");
+                }
+            }
+        }
+
+        // A single '>|' target is written directly, several go through the relay
+        if (cmd->num_tee_files == 1) {
+            int fd = open_output_file(cmd->tee_files[0], OUTPUT);
+            if (fd < 0) {
+                printf("Error: Unable to open file %s for redirecting.\n", cmd->tee_files[0]);
+                fflush(stdout);
+                _exit(1);
+            }
+            dup2(fd, STDOUT_FILENO);
+            close(fd);
+        } else if (tee != NULL) {
+            dup2(tee_pipe[1], STDOUT_FILENO);
+            close(tee_pipe[1]);
+        }
+        if (cmd->redirect != REVERSE) { // Since we already redirected stdout to the pipe and then to the file, we don't need execv() again for the reverse output
+            execv(executable_path, cmd->arguments);
+        }
+        perror("execv"); // If execv returns, there was an error
+        _exit(1); // exit() would rewind a script the shell reads through stdio
+    } else if (pid > 0) {
+        // Parent process
+        if (input_fd >= 0) {
+            close(input_fd);
+        }
+        perf_counters counters;
+        if (measure) {
+            close(release_pipe[0]);
+            measure = open_perf_counters(pid, &counters) == 0;
+            close(release_pipe[1]); // The counters start when the child calls execv()
+        }
+        int capture_fds[2];
+        if (capture) {
+            close(capture_pipes[0][1]);
+            close(capture_pipes[1][1]);
+            capture_fds[0] = capture_pipes[0][0];
+            capture_fds[1] = capture_pipes[1][0];
+        }
+        if (tee != NULL) {
+            close(tee_pipe[1]);
+            fcntl(tee->source, F_SETFL, O_NONBLOCK);
+        }
+
+        // The supervisor reaps the child, enforces its timeout and feeds its tee targets
+        job *j = add_job(pid, cmd, capture ? capture_fds : NULL, tee);
+        if (started != NULL) {
+            *started = j;
+        }
+        if (j == NULL) {
+            printf("myshell: too many jobs, %d is not supervised\n", (int)pid);
+            if (capture) {
+                close(capture_fds[0]);
+                close(capture_fds[1]);
+            }
+            if (tee != NULL) {
+                fcntl(tee->source, F_SETFL, 0);
+                while (pump_tee_relay(tee) == 0) {
+                }
+                free_tee_relay(tee);
+            }
+            if (!cmd->background && started == NULL) {
+                int status;
+                waitpid(pid, &status, 0);
+                status = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+                if (measure) {
+                    report_perf_counters(&counters, cmd, status);
+                }
+                return status;
+            }
+            return 0;
+        }
+
+        if (started != NULL) {
+            return 0;
+        }
+        if (!cmd->background) {
+            int status = wait_for_job(j);
+            if (measure) {
+                report_perf_counters(&counters, cmd, status);
+            }
+            return status;
+        }
+        printf("[%d] %d\n", j->id, (int)pid);
+        return 0;
+    }
+
+    if (capture) {
+        for (int i = 0; i < 2; i++) {
+            close(capture_pipes[i][0]);
+            close(capture_pipes[i][1]);
+        }
+    }
+    if (tee != NULL) {
+        close(tee_pipe[1]);
+        free_tee_relay(tee);
+    }
+    if (measure) {
+        close(release_pipe[0]);
+        close(release_pipe[1]);
+    }
+    if (input_fd >= 0) {
+        close(input_fd);
+    }
+    perror("Fork failed");
+    return 1;
+}
+
+/* Function: execute_command
+ * --------------------
+ * Runs an external command like spawn_command(), with the shell's stdin
+ * and stdout.
+ *
+ * returns: The exit status of a foreground command (124 if it timed out),
+ * 0 for background commands, and 1 if the child could not be created.
+ */
+int execute_command(command *cmd, const char *executable_path) {
+    return spawn_command(cmd, executable_path, NULL, NULL);
+}
+
+/* Function: run_command
+ * --------------------
+ * Dispatches a parsed command to the builtin or external command that
+ * handles it. This is the common back end of interactive input and scripts.
+ *
+ * cmd: The parsed command.
+ * executable_path: The executable resolved ahead of time for OTHER
+ * commands, or NULL to look it up in PATH now.
+ *
+ * returns: The exit status of the command.
+ */
+int run_command(command *cmd, const char *executable_path) {
+    switch (cmd->op) {
+    case NO_OP:
+        return 0;
+
+    case EXIT:
+        if (in_substitution()) {
+            return 0; // Only ends the $(...)
+        }
+        exit(EXIT_SUCCESS);
+
+    case ALIAS:
+        return handle_alias_command(cmd->arguments, cmd->num_arguments);
+
+    case JOBS:
+        return handle_jobs_command(cmd->arguments, cmd->num_arguments);
+
+    case FILTERS:
+        return handle_filters_command(cmd->arguments, cmd->num_arguments);
+
+    case WATCH:
+        return handle_watch_command(cmd);
+
+    case BENCH:
+        return handle_bench_command(cmd);
+
+    case INVALID:
+        printf("Error: Invalid syntax for '%s' command.\n", cmd->arguments[0]);
+        return 2;
+
+    case SOURCE:
+        if (cmd->num_arguments < 2) {
+            printf("Error: Invalid number of arguments for 'source' command.\n");
+            return 1;
+        }
+        return run_script(cmd->arguments[1]);
+
+    case OTHER: {
+        filter f;
+        if (compile_filter(cmd, &f, 1)) {
+            return run_filters(&f, 1, STDIN_FILENO);
+        }
+        if (executable_path == NULL) {
+            executable_path = find_executable(cmd->arguments[0]);
+        }
+        if (executable_path == NULL) {
+            printf("myshell: command not found: %s\n", cmd->arguments[0]);
+            return 127;
+        }
+        return execute_command(cmd, executable_path);
+    }
+
+    default:
+        printf("Error: Invalid command.\n");
+        return 1;
+    }
+}
+
+/* Function: is_pipe
+ * --------------------
+ * returns: 1 if a token is an unquoted '|' that separates pipeline stages
+ */
+static int is_pipe(const char *token, int flags) {
+    return flags == 0 && strcmp(token, "|") == 0;
+}
+
+/* Function: run_pipeline
+ * --------------------
+ * Runs 'a | b | c'. The longest tail of stages that are builtin filters
+ * (see compile_filter()) runs inside the shell on the read end of the last
+ * pipe; the stages before it are spawned as children connected by pipes.
+ * 'cat log | grep -F x | wc -l' therefore forks once instead of three
+ * times, and no bytes cross a pipe between grep and wc. A pipeline ending
+ * in '&' runs entirely in the background.
+ *
+ * tokens: the tokens of the pipeline, expanded
+ * quoted: the flags of the tokens
+ * tokenCount: the number of tokens
+ * document: the body of the line's here document, or NULL
+ *
+ * returns: The exit status of the last stage, 2 for a syntax error.
+ */
+static int run_pipeline(char *tokens[], int quoted[], int tokenCount, char *document) {
+    command stages[MAX_PIPELINE_STAGES];
+    filter filters[MAX_PIPELINE_STAGES];
+    job *started[MAX_PIPELINE_STAGES];
+    int statuses[MAX_PIPELINE_STAGES];
+    int numStages = 0;
+
+    int start = 0;
+    for (int i = 0; i <= tokenCount; i++) {
+        if (i < tokenCount && !is_pipe(tokens[i], quoted[i])) {
+            continue;
+        }
+        if (i == start || (i < tokenCount && numStages == MAX_PIPELINE_STAGES - 1)) {
+            printf("myshell: syntax error near '|'\n");
+            return 2;
+        }
+        stages[numStages] = parse_command(tokens + start, i - start);
+        stages[numStages].document = document;
+        command *stage = &stages[numStages++];
+        if (stage->op == INVALID) {
+            return run_command(stage, NULL);
+        }
+        if (stage->op != OTHER) {
+            printf("Error: '%s' cannot be used in a pipeline.\n", stage->arguments[0]);
+            return 1;
+        }
+        if (stage->launch.perfstat) {
+            printf("Error: 'perfstat' cannot be used in a pipeline.\n");
+            return 1;
+        }
+        start = i + 1;
+    }
+
+    // The in-process tail: filters from the end, up to one that has input
+    // of its own
+    int background = stages[numStages - 1].background;
+    int first = numStages;
+    while (!background && first > 0 && compile_filter(&stages[first - 1], &filters[first - 1], first == numStages)) {
+        first--;
+        if (filters[first].file != NULL || stages[first].input != NO_INPUT) {
+            break;
+        }
+    }
+
+    // Spawn the external stages, each reading the pipe of the one before
+    int input = -1;
+    for (int i = 0; i < first; i++) {
+        int pipefd[2] = {-1, -1};
+        if (i < numStages - 1) {
+            if (pipe(pipefd) == -1) {
+                perror("pipe");
+                pipefd[0] = pipefd[1] = -1;
+            } else {
+                fcntl(pipefd[0], F_SETFD, FD_CLOEXEC);
+                fcntl(pipefd[1], F_SETFD, FD_CLOEXEC);
+            }
+        }
+
+        started[i] = NULL;
+        stages[i].background = background;
+        const char *path = find_executable(stages[i].arguments[0]);
+        if (path == NULL) {
+            printf("myshell: command not found: %s\n", stages[i].arguments[0]);
+            statuses[i] = 127;
+        } else {
+            int stdio[2] = {input, pipefd[1]};
+            statuses[i] = spawn_command(&stages[i], path, stdio, &started[i]);
+        }
+
+        // Only the children keep the write ends, so readers see EOF
+        if (input >= 0) {
+            close(input);
+        }
+        if (pipefd[1] >= 0) {
+            close(pipefd[1]);
+        }
+        input = pipefd[0];
+        if (background && started[i] != NULL) {
+            printf("[%d] %d\n", started[i]->id, (int)started[i]->pid);
+        }
+    }
+    if (background) {
+        return 0;
+    }
+
+    int status = 0;
+    if (first < numStages) {
+        status = run_filters(&filters[first], numStages - first, input >= 0 ? input : STDIN_FILENO);
+    }
+    // Writers into a pipe nobody reads any more get SIGPIPE
+    if (input >= 0) {
+        close(input);
+    }
+    for (int i = 0; i < first; i++) {
+        if (started[i] != NULL) {
+            statuses[i] = wait_for_job(started[i]);
+        }
+    }
+    return first == numStages ? statuses[numStages - 1] : status;
+}
+
+/* Function: run_words
+ * --------------------
+ * Runs one command of a line: its command substitutions and globs are
+ * expanded, and the parsed command or pipeline is run.
+ *
+ * tokens: the command's tokens, freed here
+ * quoted: the flags of the tokens
+ * tokenCount: the number of tokens
+ * document: the body of the line's here document, or NULL
+ *
+ * returns: The exit status of the command.
+ */
+static int run_words(char *tokens[], int quoted[], int tokenCount, char *document) {
+    arena words = {0};
+
+    tokenCount = expand_substitutions(tokens, quoted, tokenCount, MAX_TOKENS - 1, &words);
+    if (tokenCount >= 0) {
+        tokenCount = expand_wildcards(tokens, quoted, tokenCount, MAX_TOKENS - 1);
+    }
+    if (tokenCount < 0) {
+        arena_free(&words);
+        return 1;
+    }
+
+    // For debugging purposes
+    // print_tokens(tokens, tokenCount);
+
+    int isPipeline = 0;
+    for (int i = 0; i < tokenCount && !isPipeline; i++) {
+        isPipeline = is_pipe(tokens[i], quoted[i]);
+    }
+
+    int status;
+    if (isPipeline) {
+        status = run_pipeline(tokens, quoted, tokenCount, document);
+    } else {
+        command cmd = parse_command(tokens, tokenCount);
+        cmd.document = document;
+        status = run_command(&cmd, NULL);
+    }
+    free_token_words(tokens, quoted, tokenCount);
+    arena_free(&words);
+
+    return status;
+}
+
+/* Function: run_line
+ * --------------------
+ * Runs one line of input whose aliases are already substituted. The line
+ * is tokenized and split into a chain ('a && b || c ; d') once; then each
+ * command is expanded and run in turn, unless the exit status so far
+ * skips it. Expansions of skipped commands never happen.
+ *
+ * line: the line to run
+ * document: the body of the line's here document, or NULL
+ *
+ * returns: The exit status of the last command that ran, 2 for a syntax
+ * error, or -1 if the line is empty.
+ */
+int run_line(char *line, char *document) {
+    char *tokens[MAX_TOKENS];
+    int quoted[MAX_TOKENS];
+    chain_link links[MAX_TOKENS];
+
+    int tokenCount = tokenize_words(line, tokens, quoted);
+    if (tokenCount <= 0) {
+        return -1;
+    }
+
+    const char *error = NULL;
+    int numLinks = split_chain(tokens, quoted, tokenCount, links, &error);
+    if (numLinks < 0) {
+        printf("myshell: syntax error near '%s'\n", error);
+        free_tokens(tokens, tokenCount);
+        return 2;
+    }
+    for (int i = 0; i < tokenCount; i++) {
+        if (!quoted[i] && is_chain_operator(tokens[i])) {
+            free(tokens[i]);
+        }
+    }
+
+    int status = 0;
+    for (int i = 0; i < numLinks; i++) {
+        char **linkTokens = tokens + links[i].start;
+        if (!link_runs(links[i].connector, status)) {
+            free_tokens(linkTokens, links[i].count);
+            continue;
+        }
+
+        // Expansions may grow the command, give it an array of its own
+        char *words[MAX_TOKENS];
+        int flags[MAX_TOKENS];
+        memcpy(words, linkTokens, links[i].count * sizeof(char *));
+        memcpy(flags, quoted + links[i].start, links[i].count * sizeof(int));
+        words[links[i].count] = NULL;
+        status = run_words(words, flags, links[i].count, document);
+    }
+
+    return status;
+}
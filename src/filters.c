@@ -0,0 +1,731 @@
+#ifdef __linux__
+#define _GNU_SOURCE
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "../lib/filters.h"
+#include "../lib/jobs.h"
+#include "../lib/launch.h"
+#include "../lib/redirect.h"
+#include "../lib/tokenize.h"
+
+// Results of feeding data to a filter
+#define FEED_MORE 0   // Send more input
+#define FEED_DONE 1   // No more input is needed (head has its lines)
+#define FEED_ERROR -1 // The output cannot be written
+
+static int filters_enabled = 1;
+
+/* Buffered writer for the output of the last filter */
+typedef struct filter_output {
+    int fd;
+    char *buffer;
+    size_t length;
+} filter_output;
+
+/* Function: set_builtin_filters
+ * --------------------
+ * Turns the in-process versions of wc -l, head -n, grep -F and tr on or
+ * off. When off, the external binaries are always run.
+ */
+void set_builtin_filters(int enabled) {
+    filters_enabled = enabled;
+}
+
+/* Function: builtin_filters_enabled
+ * --------------------
+ * returns: 1 if filters run in-process when possible, 0 otherwise
+ */
+int builtin_filters_enabled(void) {
+    return filters_enabled;
+}
+
+/* Function: parse_count
+ * --------------------
+ * Parses a non-negative decimal line count.
+ *
+ * returns: 0 on success, -1 if the text is not a plain number
+ */
+static int parse_count(const char *text, long long *count) {
+    if (*text == '\0') {
+        return -1;
+    }
+    char *end;
+    errno = 0;
+    *count = strtoll(text, &end, 10);
+    if (*end != '\0' || errno != 0 || *count < 0 || text[0] == '-' || text[0] == '+') {
+        return -1;
+    }
+    return 0;
+}
+
+/* Function: parse_set
+ * --------------------
+ * Expands a tr set with ranges (a-z) and backslash escapes into the list of
+ * its bytes. Classes like [:upper:] and repeats like [c*n] are left to the
+ * external tr.
+ *
+ * returns: the number of bytes, or -1 if the set is not supported
+ */
+static int parse_set(const char *text, unsigned char set[MAX_TRANSLATE_SET]) {
+    unsigned char chars[MAX_TRANSLATE_SET];
+    int num_chars = 0;
+
+    // Resolve escapes first, ranges work on the resulting bytes
+    int escaped[MAX_TRANSLATE_SET];
+    for (const char *c = text; *c != '\0'; c++) {
+        if (num_chars == MAX_TRANSLATE_SET || *c == '[') {
+            return -1;
+        }
+        escaped[num_chars] = 0;
+        if (*c == '\\' && c[1] != '\0') {
+            c++;
+            escaped[num_chars] = 1;
+            if (*c >= '0' && *c <= '7') {
+                int value = 0;
+                for (int digits = 0; digits < 3 && *c >= '0' && *c <= '7'; digits++, c++) {
+                    value = value * 8 + (*c - '0');
+                }
+                c--;
+                if (value > 255) {
+                    return -1;
+                }
+                chars[num_chars++] = (unsigned char)value;
+                continue;
+            }
+            const char *from = "ntrabfv\\";
+            const char *to = "\n\t\r\a\b\f\v\\";
+            const char *found = strchr(from, *c);
+            chars[num_chars++] = found != NULL ? (unsigned char)to[found - from] : (unsigned char)*c;
+        } else {
+            chars[num_chars++] = (unsigned char)*c;
+        }
+    }
+
+    int length = 0;
+    for (int i = 0; i < num_chars; i++) {
+        if (i + 2 < num_chars && chars[i + 1] == '-' && !escaped[i + 1]) {
+            if (chars[i + 2] < chars[i]) {
+                return -1; // Reversed range, an error for tr
+            }
+            for (int c = chars[i]; c <= chars[i + 2]; c++) {
+                if (length == MAX_TRANSLATE_SET) {
+                    return -1;
+                }
+                set[length++] = (unsigned char)c;
+            }
+            i += 2;
+        } else {
+            if (length == MAX_TRANSLATE_SET) {
+                return -1;
+            }
+            set[length++] = chars[i];
+        }
+    }
+    return length;
+}
+
+/* Function: compile_filter
+ * --------------------
+ * Decides whether a command can run in-process, and prepares it. Only the
+ * plain forms whose output is easy to reproduce exactly are taken:
+ * wc -l [FILE], head [-n N | -nN] [FILE], grep -F PATTERN [FILE],
+ * tr SET1 SET2 and tr -d SET1. Anything else runs the real binary.
+ *
+ * cmd: the parsed command
+ * f: the filter to fill in
+ * last: 1 if the command is the last stage of its pipeline, so it may
+ * redirect its output
+ *
+ * returns: 1 if the command runs as a builtin filter, 0 otherwise
+ */
+int compile_filter(const command *cmd, filter *f, int last) {
+    if (!filters_enabled || cmd->num_arguments == 0 || cmd->op != OTHER || cmd->background ||
+        cmd->num_tee_files > 0 || has_launch_options(&cmd->launch) || cmd->redirect == REVERSE ||
+        (!last && cmd->redirect != NO_REDIRECT)) {
+        return 0;
+    }
+
+    memset(f, 0, sizeof(filter));
+    f->cmd = cmd;
+    char *const *args = cmd->arguments;
+    int n = cmd->num_arguments;
+
+    if (strcmp(args[0], "wc") == 0) {
+        if ((n != 2 && n != 3) || strcmp(args[1], "-l") != 0) {
+            return 0;
+        }
+        f->kind = COUNT_LINES;
+        f->file = n == 3 ? args[2] : NULL;
+    } else if (strcmp(args[0], "head") == 0) {
+        int next = 1;
+        f->limit = 10;
+        if (next < n && strcmp(args[next], "-n") == 0 && next + 1 < n) {
+            if (parse_count(args[next + 1], &f->limit) != 0) {
+                return 0;
+            }
+            next += 2;
+        } else if (next < n && strncmp(args[next], "-n", 2) == 0) {
+            if (parse_count(args[next] + 2, &f->limit) != 0) {
+                return 0;
+            }
+            next++;
+        }
+        if (n - next > 1 || (next < n && args[next][0] == '-')) {
+            return 0;
+        }
+        f->kind = HEAD_LINES;
+        f->file = next < n ? args[next] : NULL;
+    } else if (strcmp(args[0], "grep") == 0) {
+        if ((n != 3 && n != 4) || strcmp(args[1], "-F") != 0 ||
+            (n == 4 && args[3][0] == '-')) {
+            return 0;
+        }
+        f->kind = GREP_FIXED;
+        f->pattern = args[2];
+        f->pattern_length = strlen(args[2]);
+        f->file = n == 4 ? args[3] : NULL;
+    } else if (strcmp(args[0], "tr") == 0) {
+        unsigned char set1[MAX_TRANSLATE_SET];
+        unsigned char set2[MAX_TRANSLATE_SET];
+        f->kind = TRANSLATE;
+        if (n == 3 && strcmp(args[1], "-d") == 0) {
+            int length = parse_set(args[2], set1);
+            if (length < 0) {
+                return 0;
+            }
+            f->delete = 1;
+            for (int i = 0; i < length; i++) {
+                f->drop[set1[i]] = 1;
+            }
+        } else if (n == 3 && args[1][0] != '-') {
+            int length1 = parse_set(args[1], set1);
+            int length2 = parse_set(args[2], set2);
+            if (length1 < 0 || length2 <= 0) {
+                return 0;
+            }
+            for (int c = 0; c < 256; c++) {
+                f->map[c] = (unsigned char)c;
+            }
+            // Like GNU tr, a short SET2 is padded with its last byte
+            for (int i = 0; i < length1; i++) {
+                f->map[set1[i]] = set2[i < length2 ? i : length2 - 1];
+            }
+        } else {
+            return 0;
+        }
+    } else {
+        return 0;
+    }
+
+    return 1;
+}
+
+/* Function: output_flush
+ * --------------------
+ * returns: 0 on success, -1 if the output cannot be written
+ */
+static int output_flush(filter_output *out) {
+    int result = write_all(out->fd, out->buffer, out->length);
+    out->length = 0;
+    return result;
+}
+
+/* Function: output_write
+ * --------------------
+ * Appends data to the output buffer, writing it out when it is full.
+ *
+ * returns: FEED_MORE on success, FEED_ERROR if the output cannot be written
+ */
+static int output_write(filter_output *out, const char *data, size_t length) {
+    if (out->length + length > FILTER_BUFFER_SIZE && output_flush(out) != 0) {
+        return FEED_ERROR;
+    }
+    if (length >= FILTER_BUFFER_SIZE) {
+        return write_all(out->fd, data, length) == 0 ? FEED_MORE : FEED_ERROR;
+    }
+    memcpy(out->buffer + out->length, data, length);
+    out->length += length;
+    return FEED_MORE;
+}
+
+/* Function: count_lines
+ * --------------------
+ * Counts the newlines in a buffer. With SSE2, 16 bytes are compared at once
+ * and the matches are summed in byte counters, which are folded into the
+ * total every 255 blocks before they can overflow. The rest goes through
+ * memchr(), which the C library vectorizes as well.
+ */
+static long long count_lines(const char *data, size_t length) {
+    long long lines = 0;
+#ifdef __SSE2__
+    const __m128i newline = _mm_set1_epi8('\n');
+    size_t i = 0;
+    while (i + 16 <= length) {
+        __m128i counts = _mm_setzero_si128();
+        for (int blocks = 0; blocks < 255 && i + 16 <= length; blocks++, i += 16) {
+            __m128i block = _mm_loadu_si128((const __m128i *)(data + i));
+            counts = _mm_sub_epi8(counts, _mm_cmpeq_epi8(block, newline));
+        }
+        __m128i sums = _mm_sad_epu8(counts, _mm_setzero_si128());
+        lines += _mm_cvtsi128_si32(sums) + _mm_extract_epi16(sums, 4);
+    }
+    data += i;
+    length -= i;
+#endif
+    const char *end = data + length;
+    while ((data = memchr(data, '\n', end - data)) != NULL) {
+        lines++;
+        data++;
+    }
+    return lines;
+}
+
+/* Function: find_fixed
+ * --------------------
+ * Finds the first occurrence of a pattern in a buffer. With SSE2, 16
+ * positions are tested at once by comparing the first and the last byte of
+ * the pattern; only positions where both match are compared in full.
+ *
+ * returns: the first occurrence, or NULL if there is none
+ */
+static const char *find_fixed(const char *haystack, size_t length, const char *pattern, size_t pattern_length) {
+    if (pattern_length == 0) {
+        return haystack;
+    }
+    if (pattern_length > length) {
+        return NULL;
+    }
+    if (pattern_length == 1) {
+        return memchr(haystack, pattern[0], length);
+    }
+
+    size_t i = 0;
+#ifdef __SSE2__
+    const __m128i first = _mm_set1_epi8(pattern[0]);
+    const __m128i last = _mm_set1_epi8(pattern[pattern_length - 1]);
+    for (; i + pattern_length - 1 + 16 <= length; i += 16) {
+        __m128i block_first = _mm_loadu_si128((const __m128i *)(haystack + i));
+        __m128i block_last = _mm_loadu_si128((const __m128i *)(haystack + i + pattern_length - 1));
+        unsigned mask = (unsigned)_mm_movemask_epi8(
+            _mm_and_si128(_mm_cmpeq_epi8(first, block_first), _mm_cmpeq_epi8(last, block_last)));
+        while (mask != 0) {
+            unsigned bit = (unsigned)__builtin_ctz(mask);
+            if (memcmp(haystack + i + bit + 1, pattern + 1, pattern_length - 2) == 0) {
+                return haystack + i + bit;
+            }
+            mask &= mask - 1;
+        }
+    }
+#endif
+
+    // The tail, or everything without SSE2
+    const char *end = haystack + length - pattern_length + 1;
+    const char *candidate = haystack + i;
+    while (candidate < end && (candidate = memchr(candidate, pattern[0], end - candidate)) != NULL) {
+        if (memcmp(candidate + 1, pattern + 1, pattern_length - 1) == 0) {
+            return candidate;
+        }
+        candidate++;
+    }
+    return NULL;
+}
+
+static int feed(filter *f, int count, filter_output *out, const char *data, size_t length);
+
+/* Function: emit
+ * --------------------
+ * Passes the output of a filter to the next one, or to the output.
+ */
+static int emit(filter *f, int count, filter_output *out, const char *data, size_t length) {
+    if (count > 1) {
+        return feed(f + 1, count - 1, out, data, length);
+    }
+    return output_write(out, data, length);
+}
+
+/* Function: report_binary_match
+ * --------------------
+ * Like GNU grep, input with a NUL byte is binary: the first match is
+ * reported on stderr instead of printing the line, and the search stops.
+ *
+ * returns: FEED_DONE
+ */
+static int report_binary_match(filter *f) {
+    f->matched = 1;
+    fprintf(stderr, "grep: %s: binary file matches\n", f->file != NULL ? f->file : "(standard input)");
+    return FEED_DONE;
+}
+
+/* Function: grep_lines
+ * --------------------
+ * Emits the lines of a block of whole lines that contain the pattern. The
+ * block is searched as a whole, so lines without a match cost nothing but
+ * the search itself.
+ */
+static int grep_lines(filter *f, int count, filter_output *out, const char *data, size_t length) {
+    const char *end = data + length;
+    while (data < end) {
+        const char *hit = find_fixed(data, end - data, f->pattern, f->pattern_length);
+        if (hit == NULL) {
+            break;
+        }
+        if (f->binary) {
+            return report_binary_match(f);
+        }
+#ifdef __linux__
+        const char *line = memrchr(data, '\n', hit - data);
+        line = line != NULL ? line + 1 : data;
+#else
+        const char *line = hit;
+        while (line > data && line[-1] != '\n') {
+            line--;
+        }
+#endif
+        const char *newline = memchr(hit, '\n', end - hit);
+        const char *next = newline != NULL ? newline + 1 : end;
+        f->matched = 1;
+        int result = emit(f, count, out, line, next - line);
+        if (result != FEED_MORE) {
+            return result;
+        }
+        data = next;
+    }
+    return FEED_MORE;
+}
+
+/* Function: keep_partial
+ * --------------------
+ * Appends bytes to grep's incomplete last line.
+ *
+ * returns: FEED_MORE, or FEED_ERROR if allocation failed
+ */
+static int keep_partial(filter *f, const char *data, size_t length) {
+    if (f->partial_length + length > f->partial_capacity) {
+        size_t capacity = f->partial_capacity ? f->partial_capacity : 4096;
+        while (capacity < f->partial_length + length) {
+            capacity *= 2;
+        }
+        char *partial = realloc(f->partial, capacity);
+        if (partial == NULL) {
+            return FEED_ERROR;
+        }
+        f->partial = partial;
+        f->partial_capacity = capacity;
+    }
+    memcpy(f->partial + f->partial_length, data, length);
+    f->partial_length += length;
+    return FEED_MORE;
+}
+
+/* Function: feed
+ * --------------------
+ * Hands a block of input to a filter, which passes what it outputs on to
+ * the rest of the chain straight away.
+ *
+ * f: the filter
+ * count: the number of filters from f to the end of the chain
+ * out: where the last filter writes
+ *
+ * returns: FEED_MORE, FEED_DONE or FEED_ERROR
+ */
+static int feed(filter *f, int count, filter_output *out, const char *data, size_t length) {
+    switch (f->kind) {
+    case COUNT_LINES:
+        f->lines += count_lines(data, length);
+        return FEED_MORE;
+
+    case HEAD_LINES: {
+        const char *end = data + length;
+        const char *cursor = data;
+        while (f->lines < f->limit && cursor < end) {
+            const char *newline = memchr(cursor, '\n', end - cursor);
+            if (newline == NULL) {
+                cursor = end;
+                break;
+            }
+            f->lines++;
+            cursor = newline + 1;
+        }
+        int result = cursor > data ? emit(f, count, out, data, cursor - data) : FEED_MORE;
+        if (result == FEED_MORE && f->lines >= f->limit) {
+            result = FEED_DONE;
+        }
+        return result;
+    }
+
+    case GREP_FIXED: {
+        // GNU grep decides per buffer as well, lines before it were text
+        if (!f->binary && memchr(data, '\0', length) != NULL) {
+            f->binary = 1;
+        }
+
+        // Complete the line left over from the last block first
+        if (f->partial_length > 0) {
+            const char *newline = memchr(data, '\n', length);
+            size_t head = newline != NULL ? (size_t)(newline + 1 - data) : length;
+            if (keep_partial(f, data, head) != FEED_MORE) {
+                return FEED_ERROR;
+            }
+            if (newline == NULL) {
+                return FEED_MORE;
+            }
+            int result = grep_lines(f, count, out, f->partial, f->partial_length);
+            f->partial_length = 0;
+            if (result != FEED_MORE) {
+                return result;
+            }
+            data += head;
+            length -= head;
+        }
+
+        size_t whole = length;
+        while (whole > 0 && data[whole - 1] != '\n') {
+            whole--;
+        }
+        int result = grep_lines(f, count, out, data, whole);
+        if (result != FEED_MORE) {
+            return result;
+        }
+        return keep_partial(f, data + whole, length - whole);
+    }
+
+    case TRANSLATE: {
+        char translated[16384];
+        while (length > 0) {
+            size_t chunk = length < sizeof(translated) ? length : sizeof(translated);
+            size_t produced = 0;
+            if (f->delete) {
+                for (size_t i = 0; i < chunk; i++) {
+                    translated[produced] = data[i];
+                    produced += !f->drop[(unsigned char)data[i]];
+                }
+            } else {
+                for (size_t i = 0; i < chunk; i++) {
+                    translated[i] = (char)f->map[(unsigned char)data[i]];
+                }
+                produced = chunk;
+            }
+            int result = emit(f, count, out, translated, produced);
+            if (result != FEED_MORE) {
+                return result;
+            }
+            data += chunk;
+            length -= chunk;
+        }
+        return FEED_MORE;
+    }
+    }
+    return FEED_ERROR;
+}
+
+/* Function: finish
+ * --------------------
+ * Tells every filter of the chain that its input ended, so that wc prints
+ * its count and grep checks a last line without a newline.
+ *
+ * returns: FEED_MORE, or FEED_ERROR if the output cannot be written
+ */
+static int finish(filter *f, int count, filter_output *out) {
+    int result = FEED_MORE;
+    if (f->kind == COUNT_LINES) {
+        char line[64 + MAX_INPUT_LENGTH];
+        int length = f->file != NULL ? snprintf(line, sizeof(line), "%lld %s\n", f->lines, f->file)
+                                     : snprintf(line, sizeof(line), "%lld\n", f->lines);
+        result = emit(f, count, out, line, length < (int)sizeof(line) ? (size_t)length : sizeof(line) - 1);
+    } else if (f->kind == GREP_FIXED && f->partial_length > 0 &&
+               find_fixed(f->partial, f->partial_length, f->pattern, f->pattern_length) != NULL) {
+        if (f->binary) {
+            if (!f->matched) {
+                report_binary_match(f);
+            }
+        } else {
+            f->matched = 1;
+            result = emit(f, count, out, f->partial, f->partial_length);
+            if (result == FEED_MORE) {
+                result = emit(f, count, out, "\n", 1);
+            }
+        }
+    }
+    free(f->partial);
+    f->partial = NULL;
+
+    if (result == FEED_ERROR || count == 1) {
+        return result == FEED_ERROR ? FEED_ERROR : FEED_MORE;
+    }
+    return finish(f + 1, count - 1, out);
+}
+
+/* Function: open_filter_input
+ * --------------------
+ * Opens the input of the first filter: its file operand, its input
+ * redirection, or the given descriptor. Errors are reported the way the
+ * coreutils tool would report them.
+ *
+ * returns: the descriptor to read, -1 on error
+ */
+static int open_filter_input(const filter *f, int input_fd) {
+    if (f->file != NULL) {
+        int fd = open(f->file, O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            int error = errno;
+            if (f->kind == HEAD_LINES) {
+                fprintf(stderr, "head: cannot open '%s' for reading: %s\n", f->file, strerror(error));
+            } else {
+                fprintf(stderr, "%s: %s: %s\n", f->cmd->arguments[0], f->file, strerror(error));
+            }
+        }
+        return fd;
+    }
+    if (f->cmd->input != NO_INPUT) {
+        return open_input(f->cmd);
+    }
+    return input_fd;
+}
+
+/* Function: run_filters
+ * --------------------
+ * Runs a chain of builtin filters inside the shell: the first reads its
+ * input in large blocks, and every block is pushed through the chain in
+ * memory, with no pipe or process between the filters. When head has its
+ * lines, reading stops and the input is closed, so the command writing
+ * into it gets SIGPIPE like it would with the real head.
+ *
+ * filters: the compiled filters, in pipeline order
+ * count: the number of filters
+ * input_fd: the read end of the pipe from the previous stage, or the
+ * shell's stdin. A pipe is read without blocking, and while it is empty
+ * the shell waits in the job supervisor's event loop, where the spawned
+ * stages' timeouts fire.
+ *
+ * returns: the exit status of the last filter
+ */
+int run_filters(filter filters[], int count, int input_fd) {
+    filter *last = &filters[count - 1];
+    // An input redirection fails in the shell, before the output is
+    // created; a missing file operand fails in the tool, after it
+    int fd = input_fd;
+    if (filters[0].file == NULL && (fd = open_filter_input(&filters[0], input_fd)) < 0) {
+        return 1;
+    }
+
+    filter_output out = {STDOUT_FILENO, malloc(FILTER_BUFFER_SIZE), 0};
+    char *buffer = malloc(FILTER_BUFFER_SIZE);
+    if (last->cmd->redirect != NO_REDIRECT) {
+        out.fd = open_output_file(last->cmd->output_file, last->cmd->redirect);
+        if (out.fd < 0) {
+            printf("Error: Unable to open file %s for redirecting.\n", last->cmd->output_file);
+        }
+    }
+    int status = 1;
+    if (out.fd >= 0 && filters[0].file != NULL && (fd = open_filter_input(&filters[0], input_fd)) < 0) {
+        status = filters[0].kind == GREP_FIXED ? 2 : 1;
+    }
+    if (out.buffer == NULL || buffer == NULL || out.fd < 0 || fd < 0) {
+        free(out.buffer);
+        free(buffer);
+        if (out.fd >= 0 && out.fd != STDOUT_FILENO) {
+            close(out.fd);
+        }
+        if (fd >= 0 && fd != input_fd) {
+            close(fd);
+        }
+        return status;
+    }
+
+    // A closed output must show up as EPIPE here, not kill the shell
+    struct sigaction ignore, previous;
+    memset(&ignore, 0, sizeof(ignore));
+    ignore.sa_handler = SIG_IGN;
+    sigaction(SIGPIPE, &ignore, &previous);
+    fflush(stdout);
+
+    // A pipe from spawned stages is waited on in the supervisor's event
+    // loop, so their timeouts and other jobs are serviced meanwhile
+    if (fd != STDIN_FILENO) {
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    }
+    int result = FEED_MORE;
+    int read_failed = 0;
+    while (result == FEED_MORE) {
+        ssize_t num_read = read(fd, buffer, FILTER_BUFFER_SIZE);
+        if (num_read < 0 && errno == EINTR) {
+            continue;
+        }
+        if (num_read < 0 && errno == EAGAIN) {
+            wait_for_activity(fd, -1);
+            continue;
+        }
+        if (num_read <= 0) {
+            read_failed = num_read < 0;
+            break;
+        }
+        result = feed(filters, count, &out, buffer, num_read);
+    }
+    if (result != FEED_ERROR) {
+        result = finish(filters, count, &out);
+    }
+    if (result != FEED_ERROR && output_flush(&out) != 0) {
+        result = FEED_ERROR;
+    }
+    int write_error = errno;
+    for (int i = 0; i < count; i++) {
+        free(filters[i].partial);
+        filters[i].partial = NULL;
+    }
+
+    sigaction(SIGPIPE, &previous, NULL);
+    free(out.buffer);
+    free(buffer);
+    if (out.fd != STDOUT_FILENO) {
+        close(out.fd);
+    }
+    if (fd != input_fd) {
+        close(fd);
+    }
+
+    if (result == FEED_ERROR) {
+        return write_error == EPIPE ? 128 + SIGPIPE : 1;
+    }
+    if (read_failed) {
+        fprintf(stderr, "%s: read error: %s\n", filters[0].cmd->arguments[0], strerror(errno));
+        return last->kind == GREP_FIXED ? 2 : 1;
+    }
+    if (last->kind == GREP_FIXED) {
+        return last->matched ? 0 : 1;
+    }
+    return 0;
+}
+
+/* Function: handle_filters_command
+ * --------------------
+ * Handles the 'filters' builtin:
+ * filters          print whether builtin filters are on
+ * filters on|off   run wc -l, head -n, grep -F and tr in-process, or always
+ *                  run the external binaries
+ *
+ * returns: 0 if the command is handled successfully, 1 otherwise
+ */
+int handle_filters_command(char **arguments, int num_arguments) {
+    if (num_arguments == 1) {
+        printf("filters %s\n", filters_enabled ? "on" : "off");
+        return 0;
+    }
+    if (num_arguments == 2 && (strcmp(arguments[1], "on") == 0 || strcmp(arguments[1], "off") == 0)) {
+        set_builtin_filters(strcmp(arguments[1], "on") == 0);
+        return 0;
+    }
+    printf("Error: Invalid syntax for 'filters' command.\n");
+    return 1;
+}
@@ -0,0 +1,762 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/syscall.h>
+#include <sys/timerfd.h>
+#endif
+
+#include "../lib/jobs.h"
+#include "../lib/launch.h"
+#include "../lib/uring.h"
+
+#define MAX_EVENTS 32
+#define POLL_INTERVAL_MS 50 // For children without a pidfd
+
+// Kinds of file descriptors in the event loop
+enum event_kind { EVENT_PROCESS,
+                  EVENT_STDOUT,
+                  EVENT_STDERR,
+                  EVENT_TIMER,
+                  EVENT_INPUT,
+                  EVENT_TEE };
+
+#define EVENT_KEY(index, kind) (((uint64_t)(index) << 8) | (kind))
+#define EVENT_INDEX(key) ((int)((key) >> 8))
+#define EVENT_KIND(key) ((int)((key)&0xff))
+
+static job jobs[MAX_JOBS];
+static int capture_enabled = 0;
+static int epoll_fd = -1;
+static unsigned long job_sequence = 0;
+static unsigned long job_started[MAX_JOBS]; // Start order, to reuse the oldest slot
+
+/* Function: set_output_capture
+ * --------------------
+ * Turns capturing of background job output on or off for jobs started
+ * from now on.
+ */
+void set_output_capture(int enabled) {
+    capture_enabled = enabled;
+}
+
+/* Function: output_capture_enabled
+ * --------------------
+ * returns: 1 if background jobs get their output captured, 0 otherwise
+ */
+int output_capture_enabled(void) {
+    return capture_enabled;
+}
+
+#ifdef __linux__
+/* Function: watch_fd
+ * --------------------
+ * Adds a file descriptor to the event loop.
+ *
+ * returns: 0 on success, -1 if the descriptor cannot be watched
+ */
+static int watch_fd(int fd, int index, int kind) {
+    struct epoll_event event;
+    event.events = EPOLLIN;
+    event.data.u64 = EVENT_KEY(index, kind);
+    return epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event);
+}
+
+/* Function: close_watched_fd
+ * --------------------
+ * Removes a file descriptor from the event loop and closes it.
+ */
+static void close_watched_fd(int *fd) {
+    if (*fd >= 0) {
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, *fd, NULL);
+        close(*fd);
+        *fd = -1;
+    }
+}
+#endif
+
+/* Function: drain_output
+ * --------------------
+ * Reads everything a job's output pipe currently holds straight into its
+ * ring buffer, without blocking. When the buffer wraps around, the oldest
+ * bytes are overwritten. The pipe is closed at end of file.
+ */
+static void drain_output(job *j, int stream) {
+    ring_buffer *ring = j->output[stream];
+    if (ring == NULL || ring->fd < 0) {
+        return;
+    }
+
+    while (1) {
+        size_t offset = ring->head % RING_BUFFER_SIZE;
+        struct iovec iov[2];
+        iov[0].iov_base = ring->data + offset;
+        iov[0].iov_len = RING_BUFFER_SIZE - offset;
+        iov[1].iov_base = ring->data;
+        iov[1].iov_len = offset;
+
+        ssize_t num_read = readv(ring->fd, iov, 2);
+        if (num_read > 0) {
+            ring->head += num_read;
+            continue;
+        }
+        if (num_read < 0 && errno == EINTR) {
+            continue;
+        }
+        if (num_read == 0 || errno != EAGAIN) {
+#ifdef __linux__
+            close_watched_fd(&ring->fd);
+#else
+            close(ring->fd);
+            ring->fd = -1;
+#endif
+        }
+        return;
+    }
+}
+
+#ifdef __linux__
+/* Function: read_outputs
+ * --------------------
+ * Reads the captured output pipes that the event loop found readable, all
+ * with a single io_uring submission, into their ring buffers. Each pipe
+ * gets one read; if more is left, epoll reports it again. If the ring
+ * cannot be used, each pipe is read with readv() instead.
+ */
+static void read_outputs(ring_buffer *rings[], int count) {
+    int fds[MAX_EVENTS];
+    struct iovec vectors[MAX_EVENTS][2];
+    ssize_t results[MAX_EVENTS];
+    int num_fds = 0;
+    for (int i = 0; i < count; i++) {
+        ring_buffer *ring = rings[i];
+        if (ring->fd < 0) {
+            continue;
+        }
+        size_t offset = ring->head % RING_BUFFER_SIZE;
+        vectors[num_fds][0].iov_base = ring->data + offset;
+        vectors[num_fds][0].iov_len = RING_BUFFER_SIZE - offset;
+        vectors[num_fds][1].iov_base = ring->data;
+        vectors[num_fds][1].iov_len = offset;
+        fds[num_fds] = ring->fd;
+        rings[num_fds++] = ring;
+    }
+    if (num_fds == 0) {
+        return;
+    }
+
+    if (uring_readv_all(fds, vectors, results, num_fds) != 0) {
+        for (int i = 0; i < num_fds; i++) {
+            results[i] = readv(fds[i], vectors[i], 2);
+            if (results[i] < 0) {
+                results[i] = -errno;
+            }
+        }
+    }
+    for (int i = 0; i < num_fds; i++) {
+        if (results[i] > 0) {
+            rings[i]->head += results[i];
+        } else if (results[i] != -EAGAIN && results[i] != -EINTR) {
+            close_watched_fd(&rings[i]->fd); // End of file or error
+        }
+    }
+}
+#endif
+
+/* Function: pump_tee
+ * --------------------
+ * Moves the output a job has written so far into its '>|' targets. The
+ * relay is freed once the job's stdout is closed.
+ */
+static void pump_tee(job *j) {
+    if (j->tee == NULL) {
+        return;
+    }
+    int result = pump_tee_relay(j->tee);
+    if (result == 0) {
+        return;
+    }
+    if (result < 0) {
+        perror("myshell: >|");
+    }
+#ifdef __linux__
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, j->tee->source, NULL);
+#endif
+    free_tee_relay(j->tee);
+    j->tee = NULL;
+}
+
+/* Function: finish_job
+ * --------------------
+ * Records the exit status and resource usage of a reaped job and releases
+ * its process and timer descriptors. Output pipes stay open until their end of file, since
+ * the job's own children may still write to them.
+ */
+static void finish_job(job *j, int status, const struct rusage *usage) {
+    j->usage = *usage;
+    if (j->timed_out) {
+        j->status = 124; // Same as coreutils timeout
+    } else if (WIFEXITED(status)) {
+        j->status = WEXITSTATUS(status);
+    } else {
+        j->status = 128 + WTERMSIG(status);
+    }
+    j->state = JOB_DONE;
+
+#ifdef __linux__
+    close_watched_fd(&j->pidfd);
+    close_watched_fd(&j->timerfd);
+#endif
+    drain_output(j, 0);
+    drain_output(j, 1);
+}
+
+/* Function: try_reap
+ * --------------------
+ * Reaps a job if it exited, without blocking.
+ */
+static void try_reap(job *j) {
+    int status;
+    struct rusage usage;
+    if (j->state == JOB_RUNNING && wait4(j->pid, &status, WNOHANG, &usage) == j->pid) {
+        finish_job(j, status, &usage);
+    }
+}
+
+#ifdef __linux__
+/* Function: arm_timer
+ * --------------------
+ * Makes a job's timer fire once after the given number of seconds.
+ */
+static void arm_timer(job *j, double seconds) {
+    struct itimerspec spec;
+    memset(&spec, 0, sizeof(spec));
+    spec.it_value.tv_sec = (time_t)seconds;
+    spec.it_value.tv_nsec = (long)((seconds - (double)spec.it_value.tv_sec) * 1e9);
+    if (spec.it_value.tv_sec == 0 && spec.it_value.tv_nsec == 0) {
+        spec.it_value.tv_nsec = 1;
+    }
+    timerfd_settime(j->timerfd, 0, &spec, NULL);
+}
+
+/* Function: signal_job
+ * --------------------
+ * Sends a signal to a job through its pidfd, which cannot hit a recycled
+ * pid, or with kill() if there is no pidfd.
+ */
+static void signal_job(job *j, int signal) {
+    if (j->pidfd < 0 || syscall(SYS_pidfd_send_signal, j->pidfd, signal, NULL, 0) != 0) {
+        kill(j->pid, signal);
+    }
+}
+
+/* Function: expire_timer
+ * --------------------
+ * Handles a job's timeout: the job gets SIGTERM first, and SIGKILL if it
+ * is still running TIMEOUT_GRACE_SECONDS later.
+ */
+static void expire_timer(job *j) {
+    uint64_t expirations;
+    if (read(j->timerfd, &expirations, sizeof(expirations)) < 0) {
+        return;
+    }
+    if (!j->timed_out) {
+        j->timed_out = 1;
+        signal_job(j, SIGTERM);
+        arm_timer(j, TIMEOUT_GRACE_SECONDS);
+    } else {
+        signal_job(j, SIGKILL);
+    }
+}
+
+/* Function: run_event_loop
+ * --------------------
+ * Waits for events of the supervised jobs and handles them: exited
+ * children are reaped, captured output is moved into ring buffers and
+ * expired timeouts stop their jobs. Nothing here blocks except epoll_wait.
+ *
+ * timeout_ms: how long to wait for the first event, -1 for no limit
+ *
+ * returns: 1 if the watched input became readable, 0 otherwise
+ */
+static int run_event_loop(int timeout_ms) {
+    // Children without a pidfd are polled
+    for (int i = 0; i < MAX_JOBS; i++) {
+        if (jobs[i].state == JOB_RUNNING && jobs[i].pidfd < 0) {
+            try_reap(&jobs[i]);
+            if (jobs[i].state == JOB_RUNNING && (timeout_ms < 0 || timeout_ms > POLL_INTERVAL_MS)) {
+                timeout_ms = POLL_INTERVAL_MS;
+            }
+        }
+    }
+
+    struct epoll_event events[MAX_EVENTS];
+    int num_events = epoll_wait(epoll_fd, events, MAX_EVENTS, timeout_ms);
+    int input_ready = 0;
+    ring_buffer *readable[MAX_EVENTS];
+    int num_readable = 0;
+
+    for (int i = 0; i < num_events; i++) {
+        uint64_t key = events[i].data.u64;
+        int kind = EVENT_KIND(key);
+        if (kind == EVENT_INPUT) {
+            input_ready = 1;
+            continue;
+        }
+
+        job *j = &jobs[EVENT_INDEX(key)];
+        if (kind == EVENT_PROCESS) {
+            try_reap(j);
+        } else if (kind == EVENT_STDOUT || kind == EVENT_STDERR) {
+            int stream = kind == EVENT_STDOUT ? 0 : 1;
+            if (current_io_backend() == IO_URING && j->output[stream] != NULL) {
+                readable[num_readable++] = j->output[stream];
+            } else {
+                drain_output(j, stream);
+            }
+        } else if (kind == EVENT_TEE) {
+            pump_tee(j);
+        } else if (kind == EVENT_TIMER && j->state == JOB_RUNNING) {
+            expire_timer(j);
+        }
+    }
+    read_outputs(readable, num_readable);
+
+    return input_ready;
+}
+#endif
+
+/* Function: release_job
+ * --------------------
+ * Frees a job slot together with its captured output.
+ */
+static void release_job(job *j) {
+    for (int stream = 0; stream < 2; stream++) {
+        if (j->output[stream] != NULL) {
+#ifdef __linux__
+            close_watched_fd(&j->output[stream]->fd);
+#else
+            if (j->output[stream]->fd >= 0) {
+                close(j->output[stream]->fd);
+            }
+#endif
+            free(j->output[stream]);
+            j->output[stream] = NULL;
+        }
+    }
+    if (j->tee != NULL) {
+#ifdef __linux__
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, j->tee->source, NULL);
+#endif
+        free_tee_relay(j->tee);
+        j->tee = NULL;
+    }
+    j->state = JOB_FREE;
+}
+
+/* Function: add_job
+ * --------------------
+ * Puts a freshly forked child under supervision: its exit is watched
+ * through a pidfd, its timeout (if any) through a timerfd, its captured
+ * output pipes (if any) are read into ring buffers and its tee relay (if
+ * any) is pumped whenever the child writes.
+ *
+ * pid: the child
+ * cmd: the command the child runs
+ * capture_fds: the read ends of the child's stdout and stderr pipes, or
+ * NULL. They must be non-blocking; the job owns them from now on.
+ * tee: the relay for the child's '>|' targets, or NULL. Its source must be
+ * non-blocking; the job owns it from now on.
+ *
+ * returns: the job, or NULL if the job table is full
+ */
+job *add_job(pid_t pid, command *cmd, int capture_fds[2], tee_relay *tee) {
+    int index = -1;
+    for (int i = 0; i < MAX_JOBS && index < 0; i++) {
+        if (jobs[i].state == JOB_FREE) {
+            index = i;
+        }
+    }
+    // Otherwise reuse the oldest finished job the user was told about
+    for (int i = 0; i < MAX_JOBS; i++) {
+        if (jobs[i].state == JOB_DONE && jobs[i].reported &&
+            (index < 0 || (jobs[index].state != JOB_FREE && job_started[i] < job_started[index]))) {
+            index = i;
+        }
+    }
+    if (index < 0) {
+        return NULL;
+    }
+
+    job *j = &jobs[index];
+    release_job(j);
+    memset(j, 0, sizeof(job));
+    j->id = index + 1;
+    j->state = JOB_RUNNING;
+    j->pid = pid;
+    j->pidfd = -1;
+    j->timerfd = -1;
+    j->background = cmd->background;
+    job_started[index] = ++job_sequence;
+
+    size_t length = 0;
+    for (int i = 0; i < cmd->num_arguments && length < sizeof(j->text); i++) {
+        length += snprintf(j->text + length, sizeof(j->text) - length, i ? " %s" : "%s", cmd->arguments[i]);
+    }
+
+    if (capture_fds != NULL) {
+        for (int stream = 0; stream < 2; stream++) {
+            j->output[stream] = malloc(sizeof(ring_buffer));
+            if (j->output[stream] == NULL) {
+                close(capture_fds[stream]);
+                continue;
+            }
+            j->output[stream]->head = 0;
+            j->output[stream]->fd = capture_fds[stream];
+        }
+    }
+    j->tee = tee;
+
+#ifdef __linux__
+    if (epoll_fd < 0) {
+        epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    }
+
+    j->pidfd = syscall(SYS_pidfd_open, pid, 0);
+    if (j->pidfd >= 0) {
+        watch_fd(j->pidfd, index, EVENT_PROCESS);
+    }
+    for (int stream = 0; stream < 2; stream++) {
+        if (j->output[stream] != NULL) {
+            watch_fd(j->output[stream]->fd, index, stream == 0 ? EVENT_STDOUT : EVENT_STDERR);
+        }
+    }
+    if (j->tee != NULL) {
+        watch_fd(j->tee->source, index, EVENT_TEE);
+    }
+    if (cmd->launch.timeout > 0) {
+        j->timerfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        if (j->timerfd >= 0) {
+            watch_fd(j->timerfd, index, EVENT_TIMER);
+            arm_timer(j, cmd->launch.timeout);
+        }
+    }
+#else
+    if (cmd->launch.timeout > 0) {
+        printf("myshell: timeout is not supported on this platform\n");
+    }
+#endif
+
+    return j;
+}
+
+/* Function: wait_for_job
+ * --------------------
+ * Runs the event loop until a job exits and its '>|' targets have all of
+ * its output, servicing every other job in the meantime, and frees the
+ * job's slot.
+ *
+ * returns: the exit status of the job (124 if it timed out)
+ */
+int wait_for_job(job *j) {
+    return wait_for_job_usage(j, NULL);
+}
+
+/* Function: wait_for_job_usage
+ * --------------------
+ * Waits for a job like wait_for_job() and also returns the CPU time and
+ * other resources the job and its reaped children used.
+ *
+ * usage: receives the resource usage, may be NULL
+ *
+ * returns: the exit status of the job (124 if it timed out)
+ */
+int wait_for_job_usage(job *j, struct rusage *usage) {
+#ifdef __linux__
+    while (j->state == JOB_RUNNING || j->tee != NULL) {
+        if (epoll_fd < 0) {
+            break;
+        }
+        run_event_loop(-1);
+    }
+#endif
+    if (j->tee != NULL) {
+        // Without an event loop the relay is pumped until the child's EOF
+        fcntl(j->tee->source, F_SETFL, 0);
+        while (j->tee != NULL) {
+            pump_tee(j);
+        }
+    }
+    if (j->state == JOB_RUNNING) {
+        int status;
+        struct rusage reaped_usage;
+        while (wait4(j->pid, &status, 0, &reaped_usage) < 0 && errno == EINTR) {
+        }
+        finish_job(j, status, &reaped_usage);
+    }
+
+    if (usage != NULL) {
+        *usage = j->usage;
+    }
+    int status = j->status;
+    release_job(j);
+    return status;
+}
+
+/* Function: cancel_job
+ * --------------------
+ * Stops a running job the way an expired timeout does: SIGTERM now, and
+ * SIGKILL if it is still running TIMEOUT_GRACE_SECONDS later. The job
+ * still has to be waited for.
+ */
+void cancel_job(job *j) {
+    if (j->state != JOB_RUNNING || j->timed_out) {
+        return;
+    }
+    j->timed_out = 1;
+#ifdef __linux__
+    signal_job(j, SIGTERM);
+    if (j->timerfd < 0 && epoll_fd >= 0) {
+        j->timerfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        if (j->timerfd >= 0) {
+            watch_fd(j->timerfd, j->id - 1, EVENT_TIMER);
+        }
+    }
+    if (j->timerfd >= 0) {
+        arm_timer(j, TIMEOUT_GRACE_SECONDS);
+    }
+#else
+    kill(j->pid, SIGTERM);
+#endif
+}
+
+/* Function: wait_for_input
+ * --------------------
+ * Runs the event loop until a file descriptor (the shell's input) becomes
+ * readable, so background jobs are serviced while the shell waits for the
+ * user.
+ *
+ * returns: 0 when the descriptor is readable
+ */
+int wait_for_input(int fd) {
+#ifdef __linux__
+    if (epoll_fd < 0 || watch_fd(fd, MAX_JOBS, EVENT_INPUT) != 0) {
+        return 0;
+    }
+    while (!run_event_loop(-1)) {
+    }
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+#endif
+    return 0;
+}
+
+/* Function: wait_for_activity
+ * --------------------
+ * Runs the event loop once: waits until a file descriptor becomes readable
+ * or a job needs attention, and services the jobs. Unlike wait_for_input()
+ * it also returns when a job finished, so a server can answer for it.
+ *
+ * fd: the descriptor to watch, or -1 to wait for jobs only
+ * timeout_ms: how long to wait at most, -1 for no limit
+ *
+ * returns: 1 if the descriptor is readable, 0 otherwise
+ */
+int wait_for_activity(int fd, int timeout_ms) {
+#ifdef __linux__
+    if (epoll_fd < 0) {
+        epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    }
+    if (epoll_fd >= 0 && (fd < 0 || watch_fd(fd, MAX_JOBS, EVENT_INPUT) == 0)) {
+        int ready = run_event_loop(timeout_ms);
+        if (fd >= 0) {
+            epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+        }
+        return ready;
+    }
+#endif
+    // Without epoll, children are polled at a fixed interval
+    struct pollfd watched = {fd, POLLIN, 0};
+    if (timeout_ms < 0 || timeout_ms > POLL_INTERVAL_MS) {
+        timeout_ms = POLL_INTERVAL_MS;
+    }
+    int ready = poll(&watched, fd >= 0 ? 1 : 0, timeout_ms) > 0;
+    poll_jobs();
+    return ready;
+}
+
+/* Function: reset_jobs
+ * --------------------
+ * Forgets every job and closes the supervisor's descriptors without
+ * touching the processes. Used in a forked copy of the shell that goes on
+ * running commands of its own: the epoll instance is shared with the
+ * parent, so it is closed before anything could be removed from it.
+ */
+void reset_jobs(void) {
+#ifdef __linux__
+    if (epoll_fd >= 0) {
+        close(epoll_fd);
+        epoll_fd = -1;
+    }
+#endif
+    for (int i = 0; i < MAX_JOBS; i++) {
+        if (jobs[i].state == JOB_FREE) {
+            continue;
+        }
+        if (jobs[i].pidfd >= 0) {
+            close(jobs[i].pidfd);
+        }
+        if (jobs[i].timerfd >= 0) {
+            close(jobs[i].timerfd);
+        }
+        release_job(&jobs[i]);
+    }
+}
+
+/* Function: poll_jobs
+ * --------------------
+ * Handles pending job events without waiting.
+ */
+void poll_jobs(void) {
+#ifdef __linux__
+    if (epoll_fd >= 0) {
+        run_event_loop(0);
+        return;
+    }
+#endif
+    for (int i = 0; i < MAX_JOBS; i++) {
+        pump_tee(&jobs[i]);
+        try_reap(&jobs[i]);
+    }
+}
+
+/* Function: describe_state
+ * --------------------
+ * Formats the state of a job for 'jobs' and finish notices.
+ */
+static void describe_state(const job *j, char *buffer, size_t size) {
+    if (j->state == JOB_RUNNING) {
+        snprintf(buffer, size, "Running");
+    } else if (j->timed_out) {
+        snprintf(buffer, size, "Timed out");
+    } else if (j->status == 0) {
+        snprintf(buffer, size, "Done");
+    } else {
+        snprintf(buffer, size, "Exit %d", j->status);
+    }
+}
+
+/* Function: report_finished_jobs
+ * --------------------
+ * Tells the user about background jobs that finished since the last
+ * prompt. Jobs without captured output are forgotten afterwards; captured
+ * output stays readable with 'jobs -o' until the slot is needed again.
+ */
+void report_finished_jobs(void) {
+    poll_jobs();
+    for (int i = 0; i < MAX_JOBS; i++) {
+        job *j = &jobs[i];
+        if (j->state == JOB_DONE && j->tee == NULL && j->background && !j->reported) {
+            char state[32];
+            describe_state(j, state, sizeof(state));
+            printf("[%d] %s\t%s\n", j->id, state, j->text);
+            j->reported = 1;
+            if (j->output[0] == NULL && j->output[1] == NULL) {
+                release_job(j);
+            }
+        }
+    }
+}
+
+/* Function: print_output
+ * --------------------
+ * Writes the captured output of one stream of a job to stdout.
+ */
+static void print_output(const ring_buffer *ring) {
+    size_t length = ring->head < RING_BUFFER_SIZE ? ring->head : RING_BUFFER_SIZE;
+    size_t start = (ring->head - length) % RING_BUFFER_SIZE;
+    size_t first = RING_BUFFER_SIZE - start < length ? RING_BUFFER_SIZE - start : length;
+
+    if (ring->head > RING_BUFFER_SIZE) {
+        printf("[%zu earlier bytes dropped]\n", ring->head - RING_BUFFER_SIZE);
+    }
+    fwrite(ring->data + start, 1, first, stdout);
+    fwrite(ring->data, 1, length - first, stdout);
+    fflush(stdout);
+}
+
+/* Function: handle_jobs_command
+ * --------------------
+ * Handles the 'jobs' builtin:
+ * jobs            list the supervised jobs
+ * jobs -o ID      print the captured stdout of a background job
+ * jobs -e ID      print the captured stderr of a background job
+ * jobs -c on|off  capture the output of background jobs started from now on
+ * jobs -p on|off  pin background jobs started from now on to one CPU each,
+ *                 taking the CPUs in turn
+ *
+ * returns: 0 if the command is handled successfully, 1 otherwise
+ */
+int handle_jobs_command(char **arguments, int num_arguments) {
+    poll_jobs();
+
+    if (num_arguments == 1) {
+        for (int i = 0; i < MAX_JOBS; i++) {
+            const job *j = &jobs[i];
+            if (j->state == JOB_FREE || !j->background) {
+                continue;
+            }
+            char state[32];
+            describe_state(j, state, sizeof(state));
+            printf("[%d] %-10s %d\t%s", j->id, state, (int)j->pid, j->text);
+            if (j->output[0] != NULL && j->output[1] != NULL) {
+                printf("\t(%zu bytes of output)", j->output[0]->head + j->output[1]->head);
+            }
+            printf("\n");
+        }
+        return 0;
+    }
+
+    if (num_arguments == 3 && strcmp(arguments[1], "-c") == 0) {
+        if (strcmp(arguments[2], "on") == 0 || strcmp(arguments[2], "off") == 0) {
+            set_output_capture(strcmp(arguments[2], "on") == 0);
+            return 0;
+        }
+    }
+
+    if (num_arguments == 3 && strcmp(arguments[1], "-p") == 0) {
+        if (strcmp(arguments[2], "on") == 0 || strcmp(arguments[2], "off") == 0) {
+            set_job_pinning(strcmp(arguments[2], "on") == 0);
+            return 0;
+        }
+    }
+
+    if (num_arguments == 3 && (strcmp(arguments[1], "-o") == 0 || strcmp(arguments[1], "-e") == 0)) {
+        int id = atoi(arguments[2]);
+        if (id < 1 || id > MAX_JOBS || jobs[id - 1].state == JOB_FREE) {
+            printf("Error: No such job: %s\n", arguments[2]);
+            return 1;
+        }
+        const ring_buffer *ring = jobs[id - 1].output[strcmp(arguments[1], "-o") == 0 ? 0 : 1];
+        if (ring == NULL) {
+            printf("Error: Output of job %d was not captured.\n", id);
+            return 1;
+        }
+        print_output(ring);
+        return 0;
+    }
+
+    printf("Error: Invalid syntax for 'jobs' command.\n");
+    return 1;
+}
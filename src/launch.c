@@ -0,0 +1,238 @@
+#ifdef __linux__
+#define _GNU_SOURCE
+#include <sched.h>
+#endif
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include "../lib/launch.h"
+
+static int pin_jobs = 0;
+static unsigned long next_job_cpu = 0;
+
+/* Function: parse_number
+ * --------------------
+ * Parses a non-negative integer, optionally followed by one of the given
+ * suffixes. Suffix i multiplies the number by 1024 to the power i + 1.
+ *
+ * returns: 0 on success, -1 if the text is not such a number
+ */
+static int parse_number(const char *text, const char *suffixes, long long *value) {
+    if (*text < '0' || *text > '9') {
+        return -1;
+    }
+    char *end;
+    errno = 0;
+    *value = strtoll(text, &end, 10);
+    if (errno != 0) {
+        return -1;
+    }
+    if (*end != '\0') {
+        const char *suffix = suffixes != NULL ? strchr(suffixes, *end) : NULL;
+        if (suffix == NULL || end[1] != '\0') {
+            return -1;
+        }
+        for (const char *s = suffixes; s <= suffix; s++) {
+            if (*value > (1LL << 52)) {
+                return -1;
+            }
+            *value *= 1024;
+        }
+    }
+    return 0;
+}
+
+/* Function: parse_cpu_list
+ * --------------------
+ * Parses the CPUs of 'pin', a comma separated list of numbers and ranges
+ * such as 0-3,8.
+ *
+ * returns: 0 on success, -1 if the list is malformed
+ */
+int parse_cpu_list(const char *text, launch_options *launch) {
+    memset(launch->cpus, 0, sizeof(launch->cpus));
+    const char *cursor = text;
+    while (*cursor != '\0') {
+        char *end;
+        long first = strtol(cursor, &end, 10);
+        long last = first;
+        if (end == cursor || *cursor == '-' || *cursor == '+') {
+            return -1;
+        }
+        if (*end == '-') {
+            cursor = end + 1;
+            last = strtol(cursor, &end, 10);
+            if (end == cursor || *cursor == '-' || *cursor == '+') {
+                return -1;
+            }
+        }
+        if (first > last || last >= MAX_PINNED_CPUS || (*end != ',' && *end != '\0')) {
+            return -1;
+        }
+        for (long cpu = first; cpu <= last; cpu++) {
+            launch->cpus[cpu / 8] |= 1 << (cpu % 8);
+        }
+        cursor = *end == ',' ? end + 1 : end;
+    }
+    launch->pinned = 1;
+    return 0;
+}
+
+/* Function: parse_nice
+ * --------------------
+ * Parses the adjustment of 'nice', an integer added to the priority.
+ *
+ * returns: 0 on success, -1 if the text is not an integer
+ */
+int parse_nice(const char *text, launch_options *launch) {
+    char *end;
+    errno = 0;
+    long value = strtol(text, &end, 10);
+    if (end == text || *end != '\0' || errno != 0 || value < -40 || value > 40) {
+        return -1;
+    }
+    launch->niced = 1;
+    launch->nice = (int)value;
+    return 0;
+}
+
+/* Function: parse_limit
+ * --------------------
+ * Parses one argument of 'limit': mem=SIZE (K, M, G or T suffix), cpu=SECS
+ * or files=N.
+ *
+ * returns: 0 on success, -1 if the key or the value is not known
+ */
+int parse_limit(const char *text, launch_options *launch) {
+    long long value;
+    if (strncmp(text, "mem=", 4) == 0 && parse_number(text + 4, "KMGT", &value) == 0 && value > 0) {
+        launch->memory_limit = value;
+    } else if (strncmp(text, "cpu=", 4) == 0 && parse_number(text + 4, NULL, &value) == 0 && value > 0) {
+        launch->cpu_limit = value;
+    } else if (strncmp(text, "files=", 6) == 0 && parse_number(text + 6, NULL, &value) == 0 && value > 0) {
+        launch->file_limit = value;
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+/* Function: has_launch_options
+ * --------------------
+ * returns: 1 if a command was given any prefix builtin, 0 otherwise
+ */
+int has_launch_options(const launch_options *launch) {
+    return launch->timeout > 0 || launch->pinned || launch->niced || launch->memory_limit > 0 ||
+           launch->cpu_limit > 0 || launch->file_limit > 0 || launch->perfstat;
+}
+
+/* Function: set_job_pinning
+ * --------------------
+ * Turns the session default for background jobs on or off: when on, every
+ * new '&' job without a 'pin' of its own is pinned to the next CPU the
+ * shell may run on, in turn.
+ */
+void set_job_pinning(int enabled) {
+    pin_jobs = enabled;
+    next_job_cpu = 0;
+}
+
+/* Function: job_pinning_enabled
+ * --------------------
+ * returns: 1 if background jobs are pinned round-robin, 0 otherwise
+ */
+int job_pinning_enabled(void) {
+    return pin_jobs;
+}
+
+/* Function: assign_job_cpu
+ * --------------------
+ * Pins a background job to the next CPU of the shell's own affinity mask
+ * if the session default is on. Called in the shell before the fork, so
+ * the turn advances for every job.
+ */
+void assign_job_cpu(launch_options *launch) {
+    if (!pin_jobs || launch->pinned) {
+        return;
+    }
+#ifdef __linux__
+    cpu_set_t allowed;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0 || CPU_COUNT(&allowed) == 0) {
+        return;
+    }
+    unsigned long turn = next_job_cpu++ % CPU_COUNT(&allowed);
+    for (int cpu = 0; cpu < CPU_SETSIZE && cpu < MAX_PINNED_CPUS; cpu++) {
+        if (CPU_ISSET(cpu, &allowed) && turn-- == 0) {
+            memset(launch->cpus, 0, sizeof(launch->cpus));
+            launch->cpus[cpu / 8] = 1 << (cpu % 8);
+            launch->pinned = 1;
+            return;
+        }
+    }
+#endif
+}
+
+/* Function: set_limit
+ * --------------------
+ * Lowers both the soft and the hard limit of a resource, so the command
+ * cannot raise it again.
+ */
+static void set_limit(int resource, long long value, const char *name) {
+    struct rlimit limit;
+    limit.rlim_cur = (rlim_t)value;
+    limit.rlim_max = (rlim_t)value;
+    if (setrlimit(resource, &limit) != 0) {
+        fprintf(stderr, "myshell: limit %s: %s\n", name, strerror(errno));
+        _exit(1);
+    }
+}
+
+/* Function: apply_launch_options
+ * --------------------
+ * Applies 'pin', 'nice' and 'limit' to the calling process. Called in the
+ * child between fork() and exec(), so the settings are inherited by the
+ * command and everything it starts, and the shell keeps its own. A CPU
+ * list or a limit that cannot be applied stops the child; a priority that
+ * cannot be raised only warns, like nice(1).
+ */
+void apply_launch_options(const launch_options *launch) {
+    if (launch->pinned) {
+#ifdef __linux__
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu = 0; cpu < CPU_SETSIZE && cpu < MAX_PINNED_CPUS; cpu++) {
+            if (launch->cpus[cpu / 8] & (1 << (cpu % 8))) {
+                CPU_SET(cpu, &set);
+            }
+        }
+        if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+            fprintf(stderr, "myshell: pin: %s\n", strerror(errno));
+            _exit(1); // exit() would flush the shell's stdio buffers again
+        }
+#else
+        fprintf(stderr, "myshell: pin is not supported on this platform\n");
+#endif
+    }
+
+    if (launch->niced) {
+        errno = 0;
+        if (nice(launch->nice) == -1 && errno != 0) {
+            fprintf(stderr, "myshell: nice: cannot set niceness: %s\n", strerror(errno));
+        }
+    }
+
+    if (launch->memory_limit > 0) {
+        set_limit(RLIMIT_AS, launch->memory_limit, "mem");
+    }
+    if (launch->cpu_limit > 0) {
+        set_limit(RLIMIT_CPU, launch->cpu_limit, "cpu");
+    }
+    if (launch->file_limit > 0) {
+        set_limit(RLIMIT_NOFILE, launch->file_limit, "files");
+    }
+}
@@ -0,0 +1,230 @@
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "../lib/completion.h"
+#include "../lib/jobs.h"
+#include "../lib/lineedit.h"
+
+#define KEY_CTRL_A 1
+#define KEY_CTRL_B 2
+#define KEY_CTRL_D 4
+#define KEY_CTRL_E 5
+#define KEY_CTRL_F 6
+#define KEY_BACKSPACE 8
+#define KEY_TAB 9
+#define KEY_CTRL_U 21
+#define KEY_ESCAPE 27
+#define KEY_DELETE 127
+
+#define ESCAPE_TIMEOUT_MS 50 // A sequence arrives at once, a lone ESC is followed by nothing
+
+/* Function: read_sequence_byte
+ * --------------------
+ * Reads the next byte of an escape sequence, waiting at most
+ * ESCAPE_TIMEOUT_MS for it.
+ *
+ * returns: 1 if a byte was read, 0 if none came
+ */
+static int read_sequence_byte(char *c) {
+    struct pollfd input = {STDIN_FILENO, POLLIN, 0};
+    return poll(&input, 1, ESCAPE_TIMEOUT_MS) == 1 && read(STDIN_FILENO, c, 1) == 1;
+}
+
+/* Function: redraw_line
+ * --------------------
+ * Redraws the prompt and the line being edited, and puts the terminal
+ * cursor at the editing position.
+ */
+static void redraw_line(const char *prompt, const char *buffer, size_t length, size_t cursor) {
+    char sequence[32];
+    fputs("\r", stdout);
+    fputs(prompt, stdout);
+    fwrite(buffer, 1, length, stdout);
+    fputs("\x1b[K", stdout); // Clear leftovers of a longer line
+    if (cursor < length) {
+        snprintf(sequence, sizeof(sequence), "\x1b[%zuD", length - cursor);
+        fputs(sequence, stdout);
+    }
+    fflush(stdout);
+}
+
+/* Function: insert_text
+ * --------------------
+ * Inserts text at the cursor if it fits in the buffer.
+ *
+ * returns: 0 if the text was inserted, 1 if the buffer is full
+ */
+static int insert_text(char *buffer, size_t size, size_t *length, size_t *cursor, const char *text, size_t text_length) {
+    if (*length + text_length >= size) {
+        return 1;
+    }
+    memmove(buffer + *cursor + text_length, buffer + *cursor, *length - *cursor);
+    memcpy(buffer + *cursor, text, text_length);
+    *length += text_length;
+    *cursor += text_length;
+    return 0;
+}
+
+/* Function: complete_line
+ * --------------------
+ * Handles the tab key. The word before the cursor is completed if it is the
+ * command name: a single match is inserted in full, several matches are
+ * extended to their longest common prefix, and if there is nothing to
+ * extend the matches are listed below the line.
+ */
+static void complete_line(char *buffer, size_t size, size_t *length, size_t *cursor) {
+    size_t start = 0;
+    while (start < *cursor && buffer[start] == ' ') {
+        start++;
+    }
+    for (size_t i = start; i < *cursor; i++) {
+        if (buffer[i] == ' ') {
+            fputs("\a", stdout); // Only command names are completed
+            return;
+        }
+    }
+
+    char prefix[MAX_INPUT_LENGTH];
+    size_t prefix_length = *cursor - start;
+    memcpy(prefix, buffer + start, prefix_length);
+    prefix[prefix_length] = '\0';
+
+    completion_result result;
+    complete_command(prefix, &result);
+    size_t common_length = strlen(result.common);
+
+    if (result.count == 0) {
+        fputs("\a", stdout);
+    } else if (result.count == 1) {
+        insert_text(buffer, size, length, cursor, result.common + prefix_length, common_length - prefix_length);
+        insert_text(buffer, size, length, cursor, " ", 1);
+    } else if (common_length > prefix_length) {
+        insert_text(buffer, size, length, cursor, result.common + prefix_length, common_length - prefix_length);
+    } else {
+        fputs("\n", stdout);
+        for (int i = 0; i < result.num_listed; i++) {
+            printf("%s  ", result.listed[i]);
+        }
+        if (result.count > result.num_listed) {
+            printf("... and %d more", result.count - result.num_listed);
+        }
+        fputs("\n", stdout);
+    }
+    free_completion_result(&result);
+
+    // Pick up new executables for the next completion
+    refresh_completion_index();
+}
+
+/* Function: read_line
+ * --------------------
+ * Prints the prompt and reads one line of input without the trailing
+ * newline. On a terminal the line is edited in raw mode with tab completion
+ * of builtins, aliases and executables in PATH; otherwise it is read with
+ * fgets().
+ *
+ * Keys: left/right arrows and Ctrl-B/Ctrl-F move the cursor, Ctrl-A/Ctrl-E
+ * go to the start/end of the line, Ctrl-U clears it and Ctrl-D on an empty
+ * line is end of file.
+ *
+ * prompt: the prompt string
+ * buffer: receives the line
+ * size: the size of the buffer
+ *
+ * returns: buffer, or NULL on end of file
+ */
+char *read_line(const char *prompt, char *buffer, size_t size) {
+    struct termios original;
+
+    if (!isatty(STDIN_FILENO) || tcgetattr(STDIN_FILENO, &original) != 0) {
+        fputs(prompt, stdout);
+        if (fgets(buffer, size, stdin) == NULL) {
+            return NULL;
+        }
+        buffer[strcspn(buffer, "\n")] = '\0';
+        return buffer;
+    }
+
+    // Index PATH in the background the first time it can be needed
+    start_completion_index();
+
+    struct termios raw = original;
+    raw.c_lflag &= ~(ICANON | ECHO);
+    raw.c_cc[VMIN] = 1;
+    raw.c_cc[VTIME] = 0;
+    tcsetattr(STDIN_FILENO, TCSADRAIN, &raw);
+
+    size_t length = 0;
+    size_t cursor = 0;
+    char *line = buffer;
+    redraw_line(prompt, buffer, length, cursor);
+
+    while (1) {
+        char c;
+        wait_for_input(STDIN_FILENO); // Keep servicing background jobs
+        if (read(STDIN_FILENO, &c, 1) != 1) {
+            line = NULL;
+            break;
+        }
+
+        if (c == '\n' || c == '\r') {
+            break;
+        } else if (c == KEY_CTRL_D) {
+            if (length == 0) {
+                line = NULL;
+                break;
+            }
+            if (cursor < length) {
+                memmove(buffer + cursor, buffer + cursor + 1, length - cursor - 1);
+                length--;
+            }
+        } else if (c == KEY_DELETE || c == KEY_BACKSPACE) {
+            if (cursor > 0) {
+                memmove(buffer + cursor - 1, buffer + cursor, length - cursor);
+                cursor--;
+                length--;
+            }
+        } else if (c == KEY_TAB) {
+            complete_line(buffer, size, &length, &cursor);
+        } else if (c == KEY_CTRL_A) {
+            cursor = 0;
+        } else if (c == KEY_CTRL_E) {
+            cursor = length;
+        } else if (c == KEY_CTRL_B) {
+            cursor -= cursor > 0;
+        } else if (c == KEY_CTRL_F) {
+            cursor += cursor < length;
+        } else if (c == KEY_CTRL_U) {
+            length = 0;
+            cursor = 0;
+        } else if (c == KEY_ESCAPE) {
+            // A lone ESC, or Alt with a key, does nothing
+            char sequence[2];
+            if (!read_sequence_byte(&sequence[0]) || sequence[0] != '[' || !read_sequence_byte(&sequence[1])) {
+                continue;
+            }
+            if (sequence[0] == '[' && sequence[1] == 'C') {
+                cursor += cursor < length;
+            } else if (sequence[0] == '[' && sequence[1] == 'D') {
+                cursor -= cursor > 0;
+            } else if (sequence[0] == '[' && sequence[1] == 'H') {
+                cursor = 0;
+            } else if (sequence[0] == '[' && sequence[1] == 'F') {
+                cursor = length;
+            }
+        } else if ((unsigned char)c >= ' ') {
+            insert_text(buffer, size, &length, &cursor, &c, 1);
+        }
+        redraw_line(prompt, buffer, length, cursor);
+    }
+
+    tcsetattr(STDIN_FILENO, TCSADRAIN, &original);
+    if (line != NULL) {
+        fputs("\n", stdout);
+    }
+    buffer[length] = '\0';
+    return line;
+}
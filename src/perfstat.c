@@ -0,0 +1,294 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#endif
+
+#include "../lib/perfstat.h"
+#include "../lib/tokenize.h"
+#include "../lib/util.h"
+
+// Positions in the event table
+enum { CYCLES,
+       INSTRUCTIONS,
+       CACHE_REFERENCES,
+       CACHE_MISSES,
+       BRANCHES,
+       BRANCH_MISSES,
+       TASK_CLOCK,
+       CONTEXT_SWITCHES,
+       CPU_MIGRATIONS,
+       PAGE_FAULTS };
+
+#ifdef __linux__
+typedef struct perf_event {
+    const char *name;
+    unsigned type;
+    unsigned long long config;
+} perf_event;
+
+// The hardware events come first, see NUM_HARDWARE_EVENTS
+static const perf_event events[NUM_PERF_EVENTS] = {
+    {"cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {"instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {"cache-references", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_REFERENCES},
+    {"cache-misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+    {"branches", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_INSTRUCTIONS},
+    {"branch-misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    {"task-clock", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK},
+    {"context-switches", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES},
+    {"cpu-migrations", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CPU_MIGRATIONS},
+    {"page-faults", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS},
+};
+
+/* Function: open_event
+ * --------------------
+ * Opens one counter on a process. It starts disabled and is enabled by
+ * the kernel when the process calls exec(), so the shell's own work
+ * between fork() and exec() is not counted; children of the process are
+ * counted too.
+ *
+ * returns: the counter's descriptor, or -1 with errno set
+ */
+static int open_event(const perf_event *event, pid_t pid, int user_only) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = event->type;
+    attr.config = event->config;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    attr.disabled = 1;
+    attr.enable_on_exec = 1;
+    attr.inherit = 1;
+    attr.exclude_kernel = user_only;
+    attr.exclude_hv = 1;
+    return (int)syscall(SYS_perf_event_open, &attr, pid, -1, -1, PERF_FLAG_FD_CLOEXEC);
+}
+
+/* Function: open_perf_counters
+ * --------------------
+ * Opens the counters of 'perfstat' on a child that has not called exec()
+ * yet. Events the kernel refuses are left out: on virtual machines and in
+ * containers the hardware events are often missing, and the software
+ * events (task-clock, context switches, migrations, page faults) are
+ * counted alone. If kernel events are not allowed (perf_event_paranoid),
+ * all events count user space only.
+ *
+ * returns: 0 if at least one counter is open, -1 otherwise
+ */
+int open_perf_counters(pid_t pid, perf_counters *counters) {
+    int opened = 0;
+    int error = 0;
+    for (counters->user_only = 0; counters->user_only < 2; counters->user_only++) {
+        int denied = 0;
+        opened = 0;
+        counters->hardware_error = 0;
+        for (int i = 0; i < NUM_PERF_EVENTS; i++) {
+            counters->fds[i] = open_event(&events[i], pid, counters->user_only);
+            if (counters->fds[i] >= 0) {
+                opened++;
+                continue;
+            }
+            error = errno;
+            denied |= error == EACCES || error == EPERM;
+            if (i < NUM_HARDWARE_EVENTS && counters->hardware_error == 0) {
+                counters->hardware_error = error;
+            }
+        }
+
+        // Retry in user space only if some event was refused for counting the kernel
+        if (!denied || counters->user_only) {
+            break;
+        }
+        for (int i = 0; i < NUM_PERF_EVENTS; i++) {
+            if (counters->fds[i] >= 0) {
+                close(counters->fds[i]);
+            }
+        }
+    }
+
+    if (opened == 0) {
+        fprintf(stderr, "myshell: perfstat: cannot open counters: %s\n", strerror(error));
+        return -1;
+    }
+    counters->started = monotonic_seconds();
+    return 0;
+}
+
+/* Function: read_counter
+ * --------------------
+ * Reads a counter, scaled up if the kernel had to multiplex it with
+ * other events for part of the time.
+ *
+ * returns: 0 on success, -1 if the counter never ran
+ */
+static int read_counter(int fd, unsigned long long *value) {
+    unsigned long long values[3]; // Count, time enabled, time running
+    if (fd < 0 || read(fd, values, sizeof(values)) != sizeof(values) || values[2] == 0) {
+        return -1;
+    }
+    *value = values[2] < values[1] ? (unsigned long long)((double)values[0] * values[1] / values[2]) : values[0];
+    return 0;
+}
+
+/* Function: ratio
+ * --------------------
+ * returns: one counter divided by another, or -1 if either is missing
+ */
+static double ratio(const unsigned long long values[], const int counted[], int numerator, int denominator) {
+    if (!counted[numerator] || !counted[denominator] || values[denominator] == 0) {
+        return -1;
+    }
+    return (double)values[numerator] / values[denominator];
+}
+
+/* Function: format_count
+ * --------------------
+ * Writes a count with thousands separators, such as 1,234,567.
+ */
+static void format_count(unsigned long long value, char *text, size_t size) {
+    char digits[32];
+    int length = snprintf(digits, sizeof(digits), "%llu", value);
+    size_t out = 0;
+    for (int i = 0; i < length && out + 2 < size; i++) {
+        if (i > 0 && (length - i) % 3 == 0) {
+            text[out++] = ',';
+        }
+        text[out++] = digits[i];
+    }
+    text[out] = '\0';
+}
+
+/* Function: write_json_number
+ * --------------------
+ * Writes a derived value, null when it could not be computed.
+ */
+static void write_json_number(FILE *file, const char *name, double value) {
+    if (value < 0) {
+        fprintf(file, ",\"%s\":null", name);
+    } else {
+        fprintf(file, ",\"%s\":%.6g", name, value);
+    }
+}
+
+/* Function: log_perf_counters
+ * --------------------
+ * Appends the result of a command to the file named by MYSHELL_PERF_LOG,
+ * one JSON object per line. Missing counters are null.
+ */
+static void log_perf_counters(const perf_counters *counters, const char *text, int status, double elapsed,
+                              const unsigned long long values[], const int counted[]) {
+    const char *path = getenv(PERF_LOG_VARIABLE);
+    if (path == NULL || *path == '\0') {
+        return;
+    }
+    FILE *log = fopen(path, "a");
+    if (log == NULL) {
+        fprintf(stderr, "myshell: perfstat: %s: %s\n", path, strerror(errno));
+        return;
+    }
+
+    fprintf(log, "{\"time\":%lld,\"command\":", (long long)time(NULL));
+    write_json_string(log, text);
+    fprintf(log, ",\"status\":%d,\"elapsed\":%.6f,\"user_only\":%s", status, elapsed,
+            counters->user_only ? "true" : "false");
+    for (int i = 0; i < NUM_PERF_EVENTS; i++) {
+        if (counted[i]) {
+            fprintf(log, ",\"%s\":%llu", events[i].name, values[i]);
+        } else {
+            fprintf(log, ",\"%s\":null", events[i].name);
+        }
+    }
+    write_json_number(log, "ipc", ratio(values, counted, INSTRUCTIONS, CYCLES));
+    write_json_number(log, "cache_miss_rate", ratio(values, counted, CACHE_MISSES, CACHE_REFERENCES));
+    write_json_number(log, "branch_miss_rate", ratio(values, counted, BRANCH_MISSES, BRANCHES));
+    fprintf(log, "}\n");
+    if (fclose(log) != 0) {
+        fprintf(stderr, "myshell: perfstat: %s: %s\n", path, strerror(errno));
+    }
+}
+
+/* Function: report_perf_counters
+ * --------------------
+ * Reads and closes the counters of a finished command and prints them to
+ * stderr with the instructions per cycle and the cache and branch miss
+ * rates, like 'perf stat'. The result is also logged if MYSHELL_PERF_LOG
+ * is set.
+ *
+ * status: the exit status of the command
+ */
+void report_perf_counters(perf_counters *counters, const command *cmd, int status) {
+    double elapsed = monotonic_seconds() - counters->started;
+    unsigned long long values[NUM_PERF_EVENTS];
+    int counted[NUM_PERF_EVENTS];
+    int hardware = 0; // Hardware events that could be opened
+    for (int i = 0; i < NUM_PERF_EVENTS; i++) {
+        counted[i] = read_counter(counters->fds[i], &values[i]) == 0;
+        hardware += i < NUM_HARDWARE_EVENTS && counters->fds[i] >= 0;
+        if (counters->fds[i] >= 0) {
+            close(counters->fds[i]);
+            counters->fds[i] = -1;
+        }
+    }
+
+    char text[MAX_INPUT_LENGTH];
+    size_t length = 0;
+    text[0] = '\0';
+    for (int i = 0; i < cmd->num_arguments && length < sizeof(text); i++) {
+        length += snprintf(text + length, sizeof(text) - length, i ? " %s" : "%s", cmd->arguments[i]);
+    }
+
+    fprintf(stderr, "\nperfstat: '%s' exited with %d after %.3f s%s\n\n", text, status, elapsed,
+            counters->user_only ? " (user space only)" : "");
+    for (int i = 0; i < NUM_PERF_EVENTS; i++) {
+        char number[32];
+        if (i < NUM_HARDWARE_EVENTS && hardware == 0) {
+            continue; // Reported once below
+        }
+        if (!counted[i]) {
+            snprintf(number, sizeof(number), "<not counted>");
+        } else if (i == TASK_CLOCK) {
+            snprintf(number, sizeof(number), "%.3f ms", values[i] / 1e6);
+        } else {
+            format_count(values[i], number, sizeof(number));
+        }
+        char note[64] = "";
+        double value;
+        if (i == INSTRUCTIONS && (value = ratio(values, counted, INSTRUCTIONS, CYCLES)) >= 0) {
+            snprintf(note, sizeof(note), "%.2f instructions per cycle", value);
+        } else if (i == CACHE_MISSES && (value = ratio(values, counted, CACHE_MISSES, CACHE_REFERENCES)) >= 0) {
+            snprintf(note, sizeof(note), "%.2f%% of cache references", value * 100);
+        } else if (i == BRANCH_MISSES && (value = ratio(values, counted, BRANCH_MISSES, BRANCHES)) >= 0) {
+            snprintf(note, sizeof(note), "%.2f%% of branches", value * 100);
+        } else if (i == TASK_CLOCK && counted[i] && elapsed > 0) {
+            snprintf(note, sizeof(note), "%.3f CPUs utilized", values[i] / 1e9 / elapsed);
+        }
+        if (note[0] != '\0') {
+            fprintf(stderr, "%20s  %-18s#  %s\n", number, events[i].name, note);
+        } else {
+            fprintf(stderr, "%20s  %s\n", number, events[i].name);
+        }
+    }
+    if (hardware == 0) {
+        fprintf(stderr, "\nperfstat: hardware counters unavailable (%s), software events only\n",
+                strerror(counters->hardware_error));
+    }
+    fprintf(stderr, "\n");
+
+    log_perf_counters(counters, text, status, elapsed, values, counted);
+}
+#else
+int open_perf_counters(pid_t pid, perf_counters *counters) {
+    fprintf(stderr, "myshell: perfstat is not supported on this platform\n");
+    return -1;
+}
+
+void report_perf_counters(perf_counters *counters, const command *cmd, int status) {
+}
+#endif
@@ -0,0 +1,420 @@
+#ifdef __linux__
+#define _GNU_SOURCE
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+#include "../lib/redirect.h"
+#include "../lib/tokenize.h"
+#include "../lib/uring.h"
+
+
+/* Function: open_output_file
+ * --------------------
+ * Opens the target of an output redirection with open(2) rather than
+ * stdio. The descriptor is close-on-exec; dup2() it onto stdout to use it.
+ *
+ * path: the file to open
+ * mode: APPEND to append to the file, anything else to truncate it
+ *
+ * returns: the file descriptor, or -1 on error
+ */
+int open_output_file(const char *path, redirect mode) {
+    int flags = O_WRONLY | O_CREAT | O_CLOEXEC;
+    flags |= mode == APPEND ? O_APPEND : O_TRUNC;
+    return open(path, flags, 0644);
+}
+
+/* Function: create_memory_file
+ * --------------------
+ * Puts the text of a here string or here document into an anonymous file
+ * that lives in memory, so the command reads it as a regular file: no
+ * writer process, no pipe capacity limit and nothing on disk. On Linux
+ * this is a memfd that is sealed against any further change.
+ *
+ * text: the contents
+ * length: the length of the contents
+ * newline: 1 to add a newline after the contents
+ *
+ * returns: a close-on-exec descriptor positioned at the start, or -1 on
+ * error
+ */
+static int create_memory_file(const char *text, size_t length, int newline) {
+#ifdef __linux__
+    int fd = memfd_create("myshell-input", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+#else
+    // Without memfd, fall back to an unlinked temporary file
+    char path[] = "/tmp/myshell-input-XXXXXX";
+    int fd = mkstemp(path);
+    if (fd >= 0) {
+        unlink(path);
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+    }
+#endif
+    if (fd < 0) {
+        return -1;
+    }
+
+#ifdef __linux__
+    // Size the file once, instead of growing it with every write
+    if (ftruncate(fd, length + (newline ? 1 : 0)) != 0) {
+        close(fd);
+        return -1;
+    }
+#endif
+    if (write_all(fd, text, length) != 0 || (newline && write_all(fd, "\n", 1) != 0)) {
+        close(fd);
+        return -1;
+    }
+#ifdef __linux__
+    fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL);
+#endif
+    lseek(fd, 0, SEEK_SET);
+    return fd;
+}
+
+/* Function: open_input
+ * --------------------
+ * Opens what an input redirection ('<', '<<<' or '<<') gives the command
+ * as its stdin. The descriptor is close-on-exec; dup2() it onto stdin to
+ * use it. A here string gets a trailing newline like in other shells.
+ *
+ * cmd: the command
+ *
+ * returns: the file descriptor, or -1 on error (which is reported)
+ */
+int open_input(const command *cmd) {
+    int fd = -1;
+    if (cmd->input == INPUT_FILE) {
+        fd = open(cmd->input_source, O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            printf("Error: Unable to open file %s for reading.\n", cmd->input_source);
+        }
+        return fd;
+    }
+
+    if (cmd->input == HERE_STRING) {
+        fd = create_memory_file(cmd->input_source, strlen(cmd->input_source), 1);
+    } else if (cmd->input == HERE_DOCUMENT) {
+        const char *document = cmd->document != NULL ? cmd->document : "";
+        fd = create_memory_file(document, strlen(document), 0);
+    }
+    if (fd < 0) {
+        perror("myshell: input");
+    }
+    return fd;
+}
+
+/* Function: find_here_document
+ * --------------------
+ * Looks for a '<<DELIMITER' or '<< DELIMITER' redirection in a line, so
+ * the reader of the line can collect the document's body before the line
+ * runs.
+ *
+ * line: the line
+ * delimiter: the buffer to store the delimiter in
+ * size: the size of the buffer
+ *
+ * returns: 1 if the line has a here document, 0 otherwise
+ */
+int find_here_document(const char *line, char *delimiter, size_t size) {
+    if (strstr(line, "<<") == NULL) {
+        return 0; // Most lines, without tokenizing them
+    }
+
+    char copy[MAX_INPUT_LENGTH];
+    char *tokens[MAX_TOKENS];
+    snprintf(copy, sizeof(copy), "%s", line);
+    int tokenCount = tokenize(copy, tokens);
+
+    int found = 0;
+    for (int i = 0; i < tokenCount && !found; i++) {
+        if (strcmp(tokens[i], "<<") == 0 && i + 1 < tokenCount) {
+            snprintf(delimiter, size, "%s", tokens[i + 1]);
+            found = 1;
+        } else if (strncmp(tokens[i], "<<", 2) == 0 && tokens[i][2] != '\0' && tokens[i][2] != '<') {
+            snprintf(delimiter, size, "%s", tokens[i] + 2);
+            found = 1;
+        }
+    }
+
+    free_tokens(tokens, tokenCount > 0 ? tokenCount : 0);
+    return found;
+}
+
+/* Function: read_here_document
+ * --------------------
+ * Reads the body of a here document: every line up to the one that
+ * consists of the delimiter alone, or up to the end of the input.
+ *
+ * delimiter: the line that ends the document
+ * next: returns the following line of input
+ * context: passed to next
+ * a: the arena the body is stored in
+ *
+ * returns: the body, each line ending in a newline, or NULL if allocation
+ * failed
+ */
+char *read_here_document(const char *delimiter, line_reader next, void *context, arena *a) {
+    arena_buffer body = {0};
+    char *line;
+    while ((line = next(context)) != NULL && strcmp(line, delimiter) != 0) {
+        size_t length = strlen(line);
+        char *space = arena_buffer_reserve(a, &body, length + 1);
+        if (space == NULL) {
+            return NULL;
+        }
+        memcpy(space, line, length);
+        space[length] = '\n';
+        body.length += length + 1;
+    }
+
+    if (arena_buffer_reserve(a, &body, 1) == NULL) {
+        return NULL;
+    }
+    body.data[body.length] = '\0';
+    return body.data;
+}
+
+/* Function: create_tee_relay
+ * --------------------
+ * Opens every target of a tee redirection and prepares the pipes that let
+ * the data be duplicated inside the kernel.
+ *
+ * source: the read end of the command's stdout pipe; the relay owns it
+ * paths: the target files
+ * num_paths: the number of targets
+ *
+ * returns: the relay, or NULL if a target cannot be opened
+ */
+tee_relay *create_tee_relay(int source, char **paths, int num_paths) {
+    tee_relay *relay = calloc(1, sizeof(tee_relay));
+    if (relay == NULL) {
+        close(source);
+        return NULL;
+    }
+    relay->source = source;
+    for (int i = 0; i < MAX_TEE_TARGETS; i++) {
+        relay->files[i] = -1;
+        relay->pipes[i][0] = relay->pipes[i][1] = -1;
+    }
+
+    for (int i = 0; i < num_paths; i++) {
+        relay->files[i] = open_output_file(paths[i], OUTPUT);
+        if (relay->files[i] < 0) {
+            printf("Error: Unable to open file %s for redirecting.\n", paths[i]);
+            free_tee_relay(relay);
+            return NULL;
+        }
+        relay->num_files++;
+    }
+
+#ifdef __linux__
+    fcntl(source, F_SETPIPE_SZ, TEE_CHUNK_SIZE);
+    for (int i = 0; i < num_paths - 1; i++) {
+        if (pipe2(relay->pipes[i], O_CLOEXEC) != 0) {
+            relay->copy = 1;
+            break;
+        }
+        fcntl(relay->pipes[i][1], F_SETPIPE_SZ, TEE_CHUNK_SIZE);
+    }
+#else
+    relay->copy = 1;
+#endif
+
+    return relay;
+}
+
+/* Function: write_all
+ * --------------------
+ * Writes a whole buffer to a file descriptor.
+ *
+ * returns: 0 on success, -1 on error
+ */
+int write_all(int fd, const char *buffer, size_t length) {
+    while (length > 0) {
+        ssize_t written = write(fd, buffer, length);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        buffer += written;
+        length -= written;
+    }
+    return 0;
+}
+
+/* Function: pump_copy
+ * --------------------
+ * Fallback for kernels or files without tee()/splice(): reads what the
+ * source holds and writes it to every target from user space.
+ *
+ * returns: 0 if the source may have more data, 1 at end of file, -1 on
+ * error
+ */
+static int pump_copy(tee_relay *relay) {
+    static char buffer[65536];
+    while (1) {
+        ssize_t num_read = read(relay->source, buffer, sizeof(buffer));
+        if (num_read < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return errno == EAGAIN ? 0 : -1;
+        }
+        if (num_read == 0) {
+            return 1;
+        }
+        for (int i = 0; i < relay->num_files; i++) {
+            if (write_all(relay->files[i], buffer, num_read) != 0) {
+                return -1;
+            }
+        }
+    }
+}
+
+#ifdef __linux__
+/* Function: splice_all
+ * --------------------
+ * Moves exactly length bytes from a pipe into a file with splice(), or
+ * with read()/write() if the file does not support splicing.
+ *
+ * returns: 0 on success, -1 on error
+ */
+static int splice_all(tee_relay *relay, int from, int to, size_t length) {
+    while (length > 0) {
+        ssize_t moved = relay->copy ? -1 : splice(from, NULL, to, NULL, length, SPLICE_F_MOVE);
+        if (moved > 0) {
+            length -= moved;
+            continue;
+        }
+        if (moved < 0 && errno == EINTR && !relay->copy) {
+            continue;
+        }
+        if (moved == 0 || (!relay->copy && errno != EINVAL)) {
+            return -1;
+        }
+
+        // The target cannot be spliced into, copy the rest of this chunk
+        relay->copy = 1;
+        char buffer[65536];
+        size_t chunk = length < sizeof(buffer) ? length : sizeof(buffer);
+        ssize_t num_read = read(from, buffer, chunk);
+        if (num_read <= 0 || write_all(to, buffer, num_read) != 0) {
+            return -1;
+        }
+        length -= num_read;
+    }
+    return 0;
+}
+#endif
+
+/* Function: pump_tee_relay
+ * --------------------
+ * Moves everything the command has written so far into all targets. On
+ * Linux the data never enters user space: tee() duplicates the source
+ * pipe into one pipe per extra target without consuming it, splice()
+ * moves those pipes into their files, and the source itself is finally
+ * spliced into the last target. The source must be non-blocking. With
+ * MYSHELL_IO=uring the data is copied through registered buffers instead,
+ * one io_uring submission per chunk for all targets; with MYSHELL_IO=rw it
+ * goes through read() and write().
+ *
+ * returns: 0 if the command may write more, 1 at end of file, -1 on error
+ */
+int pump_tee_relay(tee_relay *relay) {
+    io_backend backend = current_io_backend();
+    if (backend == IO_URING) {
+        int result = uring_pump_copy(relay->source, relay->files, relay->num_files);
+        if (result != -1 || errno != ENOSYS) {
+            return result;
+        }
+        // No ring could be set up and nothing has moved, use splice()
+    }
+    if (backend == IO_READ_WRITE) {
+        relay->copy = 1;
+    }
+#ifdef __linux__
+    while (!relay->copy) {
+        ssize_t length = TEE_CHUNK_SIZE;
+
+        // Duplicate the pending data for every target but the last
+        for (int i = 0; i < relay->num_files - 1; i++) {
+            ssize_t duplicated = tee(relay->source, relay->pipes[i][1], length, SPLICE_F_NONBLOCK);
+            if (duplicated < 0) {
+                if (errno == EAGAIN && i == 0) {
+                    return 0;
+                }
+                if (errno == EINVAL && i == 0) {
+                    relay->copy = 1; // No tee() support, nothing moved yet
+                    break;
+                }
+                return -1;
+            }
+            if (duplicated == 0) {
+                return 1;
+            }
+            length = duplicated; // Later targets take exactly as much
+        }
+        if (relay->copy) {
+            break;
+        }
+
+        for (int i = 0; i < relay->num_files - 1; i++) {
+            if (splice_all(relay, relay->pipes[i][0], relay->files[i], length) != 0) {
+                return -1;
+            }
+        }
+
+        // The last target consumes the data from the source
+        int last = relay->files[relay->num_files - 1];
+        if (relay->num_files == 1) {
+            ssize_t moved = splice(relay->source, NULL, last, NULL, length, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+            if (moved == 0) {
+                return 1;
+            }
+            if (moved < 0) {
+                return errno == EAGAIN ? 0 : -1;
+            }
+        } else if (splice_all(relay, relay->source, last, length) != 0) {
+            return -1;
+        }
+    }
+#endif
+    return pump_copy(relay);
+}
+
+/* Function: free_tee_relay
+ * --------------------
+ * Closes the source, the targets and the pipes of a relay.
+ */
+void free_tee_relay(tee_relay *relay) {
+    if (relay == NULL) {
+        return;
+    }
+    if (relay->source >= 0) {
+        close(relay->source);
+    }
+    for (int i = 0; i < MAX_TEE_TARGETS; i++) {
+        if (relay->files[i] >= 0) {
+            close(relay->files[i]);
+        }
+        for (int end = 0; end < 2; end++) {
+            if (relay->pipes[i][end] >= 0) {
+                close(relay->pipes[i][end]);
+            }
+        }
+    }
+    free(relay);
+}
@@ -0,0 +1,849 @@
+#include <limits.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../lib/alias.h"
+#include "../lib/dirscan.h"
+#include "../lib/executor.h"
+#include "../lib/jobs.h"
+#include "../lib/redirect.h"
+#include "../lib/script.h"
+#include "../lib/substitute.h"
+#include "../lib/tokenize.h"
+#include "../lib/wildcard.h"
+
+// Compiled scripts of this session, keyed by canonical path
+static plan *plans[MAX_PLANS];
+static int num_plans = 0;
+
+/* Function: identify_file
+ * --------------------
+ * Fills in the identity of a file from its stat data, or zeroes it.
+ *
+ * st: the stat data, or NULL if the file does not exist
+ */
+static void identify_file(file_identity *id, const struct stat *st) {
+    memset(id, 0, sizeof(file_identity));
+    if (st != NULL) {
+        id->device = st->st_dev;
+        id->inode = st->st_ino;
+        id->mtime = stat_mtime(st);
+        id->size = st->st_size;
+    }
+}
+
+/* Function: identify_aliases
+ * --------------------
+ * Takes the identity of the .aliases file the front end reads now. The
+ * alias builtin replaces the file on every change, so a new inode or
+ * mtime means the aliases may differ.
+ */
+static void identify_aliases(file_identity *id) {
+    struct stat st;
+    identify_file(id, stat(".aliases", &st) == 0 ? &st : NULL);
+}
+
+/* Function: same_file
+ * --------------------
+ * returns: 1 if two identities are of the same version of a file
+ */
+static int same_file(const file_identity *a, const file_identity *b) {
+    return a->device == b->device && a->inode == b->inode && a->mtime.tv_sec == b->mtime.tv_sec &&
+           a->mtime.tv_nsec == b->mtime.tv_nsec && a->size == b->size;
+}
+
+/* Function: same_string
+ * --------------------
+ * returns: 1 if two strings are equal or both NULL
+ */
+static int same_string(const char *a, const char *b) {
+    if (a == NULL || b == NULL) {
+        return a == b;
+    }
+    return strcmp(a, b) == 0;
+}
+
+/* Function: plan_is_current
+ * --------------------
+ * Checks whether a plan was compiled from the file described by st, with
+ * the aliases and PATH that are in effect now.
+ *
+ * returns: 1 if nothing the plan depends on changed, 0 otherwise
+ */
+static int plan_is_current(const plan *p, const struct stat *st) {
+    file_identity script, aliases;
+    identify_file(&script, st);
+    identify_aliases(&aliases);
+    return same_file(&p->script, &script) && same_file(&p->aliases, &aliases) &&
+           same_string(p->search_path, getenv("PATH"));
+}
+
+/* Function: new_plan
+ * --------------------
+ * Allocates an empty plan for the script at path, recording the aliases
+ * and PATH it is about to be compiled with.
+ *
+ * returns: the plan, or NULL if allocation failed
+ */
+static plan *new_plan(const char *path, const struct stat *st) {
+    plan *p = calloc(1, sizeof(plan));
+    if (p == NULL) {
+        return NULL;
+    }
+    p->path = strdup(path);
+    identify_file(&p->script, st);
+    identify_aliases(&p->aliases);
+    const char *search_path = getenv("PATH");
+    if (p->path == NULL || (search_path != NULL && (p->search_path = strdup(search_path)) == NULL)) {
+        free(p->path);
+        free(p);
+        return NULL;
+    }
+    return p;
+}
+
+/* Function: free_plan
+ * --------------------
+ * Releases a plan together with all of its strings.
+ */
+static void free_plan(plan *p) {
+    if (p == NULL) {
+        return;
+    }
+    arena_free(&p->strings);
+    free(p->entries);
+    free(p->path);
+    free(p->search_path);
+    free(p);
+}
+
+/* Function: find_plan
+ * --------------------
+ * Looks up the cached plan of a script.
+ *
+ * returns: the index of the plan in the cache, or -1 if there is none
+ */
+static int find_plan(const char *path) {
+    for (int i = 0; i < num_plans; i++) {
+        if (strcmp(plans[i]->path, path) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/* Function: cache_plan
+ * --------------------
+ * Stores a plan in the session cache, replacing a stale plan of the same
+ * script. Plans that cannot be cached (the cache is full, or the stale plan
+ * is still running) are released.
+ */
+static void cache_plan(plan *p) {
+    int index = find_plan(p->path);
+    if (index >= 0) {
+        if (plans[index]->active > 0) {
+            free_plan(p);
+            return;
+        }
+        free_plan(plans[index]);
+        plans[index] = p;
+    } else if (num_plans < MAX_PLANS) {
+        plans[num_plans++] = p;
+    } else {
+        free_plan(p);
+    }
+}
+
+/* Function: append_entry
+ * --------------------
+ * Adds an empty entry to the end of a plan, growing it as needed.
+ *
+ * returns: the new entry, or NULL if allocation failed
+ */
+static plan_entry *append_entry(plan *p) {
+    if (p->count == p->capacity) {
+        int capacity = p->capacity ? p->capacity * 2 : 64;
+        plan_entry *entries = realloc(p->entries, capacity * sizeof(plan_entry));
+        if (entries == NULL) {
+            return NULL;
+        }
+        p->entries = entries;
+        p->capacity = capacity;
+    }
+    plan_entry *entry = &p->entries[p->count++];
+    memset(entry, 0, sizeof(plan_entry));
+    return entry;
+}
+
+/* Function: compile_command
+ * --------------------
+ * Parses the tokens of one command into a plan entry, copying every string
+ * the entry keeps into the plan's arena. The executable of an OTHER
+ * command is resolved in PATH here.
+ *
+ * returns: 0 on success, -1 if allocation failed
+ */
+static int compile_command(plan *p, plan_entry *entry, char *tokens[], int tokenCount) {
+    command cmd = parse_command(tokens, tokenCount);
+
+    entry->op = cmd.op;
+    entry->background = cmd.background;
+    entry->redirect = cmd.redirect;
+    entry->launch = cmd.launch;
+    entry->num_arguments = cmd.num_arguments;
+    entry->arguments = arena_alloc(&p->strings, (cmd.num_arguments + 1) * sizeof(char *));
+    entry->tee_files = arena_alloc(&p->strings, (cmd.num_tee_files + 1) * sizeof(char *));
+    if (entry->arguments == NULL || entry->tee_files == NULL) {
+        return -1;
+    }
+    for (int i = 0; i < cmd.num_arguments; i++) {
+        if ((entry->arguments[i] = arena_strdup(&p->strings, cmd.arguments[i])) == NULL) {
+            return -1;
+        }
+    }
+    entry->arguments[cmd.num_arguments] = NULL;
+    if (cmd.output_file && (entry->output_file = arena_strdup(&p->strings, cmd.output_file)) == NULL) {
+        return -1;
+    }
+    entry->input = cmd.input;
+    if (cmd.input_source && (entry->input_source = arena_strdup(&p->strings, cmd.input_source)) == NULL) {
+        return -1;
+    }
+    entry->num_tee_files = cmd.num_tee_files;
+    for (int i = 0; i < cmd.num_tee_files; i++) {
+        if ((entry->tee_files[i] = arena_strdup(&p->strings, cmd.tee_files[i])) == NULL) {
+            return -1;
+        }
+    }
+    if (cmd.op == OTHER) {
+        char *executable = find_executable(cmd.arguments[0]);
+        if (executable && (entry->executable = arena_strdup(&p->strings, executable)) == NULL) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/* Function: compile_line
+ * --------------------
+ * Runs the front end (alias substitution, tokenize and parse_command) over
+ * one script line and appends the result to a plan: one entry per command
+ * of a chain, each recording how it depends on the status of the one
+ * before. Executables are resolved in PATH once, here, rather than every
+ * time the line runs. Lines with globs, $(...), pipelines or a malformed
+ * chain only get their aliases substituted and become a single entry.
+ *
+ * returns: the number of new entries, 0 for empty lines, -1 if allocation
+ * failed and the plan is incomplete
+ */
+static int compile_line(plan *p, char *line, char *document) {
+    char output[MAX_INPUT_LENGTH];
+    char *tokens[MAX_TOKENS];
+    int quoted[MAX_TOKENS];
+    chain_link links[MAX_TOKENS];
+
+    replace_alias_in_command(line, output, MAX_INPUT_LENGTH);
+
+    int tokenCount = tokenize_words(output, tokens, quoted);
+    if (tokenCount <= 0) {
+        return 0;
+    }
+
+    // Glob matches and command output can change between runs, such lines
+    // are expanded when they run; pipelines run through run_line() as well
+    int dynamic = 0;
+    if (strcmp(tokens[0], "alias") != 0) {
+        for (int i = 0; i < tokenCount && !dynamic; i++) {
+            dynamic = (!quoted[i] && (has_wildcard(tokens[i]) || strcmp(tokens[i], "|") == 0)) ||
+                      has_substitution(tokens[i]);
+        }
+    }
+    const char *error = NULL;
+    int numLinks = dynamic ? -1 : split_chain(tokens, quoted, tokenCount, links, &error);
+    if (numLinks < 0) {
+        plan_entry *entry = append_entry(p);
+        if (entry != NULL) {
+            entry->document = document;
+            entry->source = arena_strdup(&p->strings, output);
+        }
+        free_tokens(tokens, tokenCount);
+        return entry != NULL && entry->source != NULL ? 1 : -1;
+    }
+
+    int count = 0;
+    for (int i = 0; i < numLinks && count >= 0; i++) {
+        plan_entry *entry = append_entry(p);
+        if (entry == NULL) {
+            count = -1;
+            break;
+        }
+        entry->connector = links[i].connector;
+        entry->document = document;
+        count = compile_command(p, entry, tokens + links[i].start, links[i].count) == 0 ? count + 1 : -1;
+    }
+
+    free_tokens(tokens, tokenCount);
+    return count;
+}
+
+/* The state of read_script_line() */
+typedef struct script_reader {
+    FILE *file;
+    char *line;
+    size_t capacity;
+} script_reader;
+
+/* Function: read_script_line
+ * --------------------
+ * Reads the next line of a script for a here document. Unlike the
+ * commands, document lines can be of any length.
+ *
+ * returns: the line without its newline, or NULL at the end of the file
+ */
+static char *read_script_line(void *context) {
+    script_reader *reader = context;
+    ssize_t length = getline(&reader->line, &reader->capacity, reader->file);
+    if (length < 0) {
+        return NULL;
+    }
+    reader->line[strcspn(reader->line, "\n")] = '\0';
+    return reader->line;
+}
+
+/* Function: run_entry
+ * --------------------
+ * Executes one compiled command through the shell's back end, unless the
+ * exit status of the command before skips it.
+ *
+ * status: the exit status of the last command that ran
+ *
+ * returns: the exit status of the command, or status if it was skipped
+ */
+static int run_entry(const plan_entry *entry, int status) {
+    if (!link_runs(entry->connector, status)) {
+        return status;
+    }
+    if (entry->source != NULL) {
+        char line[MAX_INPUT_LENGTH];
+        snprintf(line, sizeof(line), "%s", entry->source);
+        return run_line(line, entry->document);
+    }
+
+    command cmd;
+    cmd.op = entry->op;
+    cmd.background = entry->background;
+    cmd.redirect = entry->redirect;
+    cmd.launch = entry->launch;
+    cmd.output_file = entry->output_file;
+    cmd.input = entry->input;
+    cmd.input_source = entry->input_source;
+    cmd.document = entry->document;
+    cmd.num_tee_files = entry->num_tee_files;
+    memcpy(cmd.tee_files, entry->tee_files, entry->num_tee_files * sizeof(char *));
+    cmd.num_arguments = entry->num_arguments;
+    memcpy(cmd.arguments, entry->arguments, entry->num_arguments * sizeof(char *));
+
+    return run_command(&cmd, entry->executable);
+}
+
+/* Function: plan_file_path
+ * --------------------
+ * Builds the path a plan is persisted under: $MYSHELL_PLAN_DIR/<hash>.plan,
+ * where hash is the FNV-1a hash of the script's canonical path.
+ *
+ * returns: 0 if persistence is enabled and the path fits, 1 otherwise
+ */
+static int plan_file_path(const char *script_path, char *buffer, size_t buffer_size) {
+    char *dir = getenv("MYSHELL_PLAN_DIR");
+    if (dir == NULL || *dir == '\0') {
+        return 1;
+    }
+
+    uint64_t hash = 14695981039346656037ULL;
+    for (const char *c = script_path; *c; c++) {
+        hash = (hash ^ (unsigned char)*c) * 1099511628211ULL;
+    }
+
+    int length = snprintf(buffer, buffer_size, "%s/%016llx.plan", dir, (unsigned long long)hash);
+    return length < 0 || (size_t)length >= buffer_size;
+}
+
+/* Function: write_string
+ * --------------------
+ * Writes a length prefixed string to a plan file. NULL is written as -1.
+ */
+static void write_string(FILE *fp, const char *s) {
+    if (s == NULL) {
+        fprintf(fp, "-1\n");
+    } else {
+        fprintf(fp, "%zu %s\n", strlen(s), s);
+    }
+}
+
+/* Function: write_bytes
+ * --------------------
+ * Writes a byte array to a plan file as a length prefixed hex string.
+ */
+static void write_bytes(FILE *fp, const void *data, size_t size) {
+    fprintf(fp, "%zu ", 2 * size);
+    for (size_t i = 0; i < size; i++) {
+        fprintf(fp, "%02x", ((const unsigned char *)data)[i]);
+    }
+    fprintf(fp, "\n");
+}
+
+/* Function: write_launch
+ * --------------------
+ * Writes the launch options of an entry field by field: one line with
+ * timeout pinned niced nice memory_limit cpu_limit file_limit perfstat,
+ * and the CPU bitmap in hex.
+ */
+static void write_launch(FILE *fp, const launch_options *launch) {
+    fprintf(fp, "%.17g %d %d %d %lld %lld %lld %d\n", launch->timeout, launch->pinned, launch->niced,
+            launch->nice, launch->memory_limit, launch->cpu_limit, launch->file_limit, launch->perfstat);
+    write_bytes(fp, launch->cpus, sizeof(launch->cpus));
+}
+
+/* Function: save_plan
+ * --------------------
+ * Persists a plan so that later shells can skip compiling the script. The
+ * file is written under a temporary name and renamed into place.
+ *
+ * Format:
+ * PLAN_MAGIC
+ * path
+ * device inode mtime_sec mtime_nsec size count
+ * device inode mtime_sec mtime_nsec size (of .aliases)
+ * length PATH
+ * op connector background redirect input num_arguments num_tee_files
+ * length string                          (one line per entry, followed by
+ *                                         its arguments, output file, tee
+ *                                         files, input source, document,
+ *                                         executable and source, -1 for
+ *                                         NULL, and its launch options,
+ *                                         see write_launch())
+ *
+ * returns: 0 if the plan was written, 1 otherwise
+ */
+static int save_plan(const plan *p) {
+    char file_path[PATH_MAX];
+    char temp_path[PATH_MAX + 8];
+    if (plan_file_path(p->path, file_path, sizeof(file_path)) != 0) {
+        return 1;
+    }
+    snprintf(temp_path, sizeof(temp_path), "%s.%d", file_path, (int)getpid());
+
+    FILE *fp = fopen(temp_path, "w");
+    if (fp == NULL) {
+        return 1;
+    }
+
+    fprintf(fp, "%s\n", PLAN_MAGIC);
+    write_string(fp, p->path);
+    fprintf(fp, "%llu %llu %lld %ld %lld %d\n", (unsigned long long)p->script.device,
+            (unsigned long long)p->script.inode, (long long)p->script.mtime.tv_sec,
+            p->script.mtime.tv_nsec, (long long)p->script.size, p->count);
+    fprintf(fp, "%llu %llu %lld %ld %lld\n", (unsigned long long)p->aliases.device,
+            (unsigned long long)p->aliases.inode, (long long)p->aliases.mtime.tv_sec,
+            p->aliases.mtime.tv_nsec, (long long)p->aliases.size);
+    write_string(fp, p->search_path);
+    for (int i = 0; i < p->count; i++) {
+        const plan_entry *entry = &p->entries[i];
+        fprintf(fp, "%d %d %d %d %d %d %d\n", entry->op, entry->connector, entry->background,
+                entry->redirect, entry->input, entry->num_arguments, entry->num_tee_files);
+        for (int j = 0; j < entry->num_arguments; j++) {
+            write_string(fp, entry->arguments[j]);
+        }
+        write_string(fp, entry->output_file);
+        for (int j = 0; j < entry->num_tee_files; j++) {
+            write_string(fp, entry->tee_files[j]);
+        }
+        write_string(fp, entry->input_source);
+        write_string(fp, entry->document);
+        write_string(fp, entry->executable);
+        write_string(fp, entry->source);
+        write_launch(fp, &entry->launch);
+    }
+
+    if (fclose(fp) != 0 || rename(temp_path, file_path) != 0) {
+        remove(temp_path);
+        return 1;
+    }
+    return 0;
+}
+
+/* Function: read_string
+ * --------------------
+ * Reads a length prefixed string in place: the string is terminated inside
+ * the file buffer, so loading a plan copies no strings.
+ *
+ * cursor: the read position, advanced past the string
+ * end: the end of the buffer
+ * out: receives the string, or NULL
+ *
+ * returns: 0 on success, 1 if the buffer is malformed
+ */
+static int read_string(char **cursor, char *end, char **out) {
+    char *next;
+    long length = strtol(*cursor, &next, 10);
+    if (next == *cursor || next >= end) {
+        return 1;
+    }
+    if (length < 0) {
+        *out = NULL;
+        *cursor = next + 1;
+        return 0;
+    }
+    if (*next != ' ' || next + 1 + length >= end || next[1 + length] != '\n') {
+        return 1;
+    }
+    *out = next + 1;
+    next[1 + length] = '\0';
+    *cursor = next + 2 + length;
+    return 0;
+}
+
+/* Function: read_bytes
+ * --------------------
+ * Reads a byte array written by write_bytes(). The size must match.
+ *
+ * returns: 0 on success, 1 if the buffer is malformed
+ */
+static int read_bytes(char **cursor, char *end, void *data, size_t size) {
+    char *hex;
+    if (read_string(cursor, end, &hex) != 0 || hex == NULL || strlen(hex) != 2 * size) {
+        return 1;
+    }
+    for (size_t i = 0; i < size; i++) {
+        unsigned int byte;
+        if (sscanf(hex + 2 * i, "%2x", &byte) != 1) {
+            return 1;
+        }
+        ((unsigned char *)data)[i] = byte;
+    }
+    return 0;
+}
+
+/* Function: read_number
+ * --------------------
+ * Reads one integer field of a plan file.
+ *
+ * returns: 0 on success, 1 if the buffer is malformed
+ */
+static int read_number(char **cursor, long long *out) {
+    char *next;
+    *out = strtoll(*cursor, &next, 10);
+    if (next == *cursor) {
+        return 1;
+    }
+    *cursor = next;
+    return 0;
+}
+
+/* Function: read_flag
+ * --------------------
+ * Reads an integer field that must be 0 or 1.
+ *
+ * returns: 0 on success, 1 if the buffer is malformed
+ */
+static int read_flag(char **cursor, int *out) {
+    long long value;
+    if (read_number(cursor, &value) || value < 0 || value > 1) {
+        return 1;
+    }
+    *out = (int)value;
+    return 0;
+}
+
+/* Function: read_launch
+ * --------------------
+ * Reads launch options written by write_launch(), checking every value
+ * against what the prefix builtins can produce.
+ *
+ * returns: 0 on success, 1 if the buffer is malformed
+ */
+static int read_launch(char **cursor, char *end, launch_options *launch) {
+    memset(launch, 0, sizeof(launch_options));
+    char *next;
+    launch->timeout = strtod(*cursor, &next);
+    if (next == *cursor || !isfinite(launch->timeout) || launch->timeout < 0) {
+        return 1;
+    }
+    *cursor = next;
+    long long nice;
+    if (read_flag(cursor, &launch->pinned) || read_flag(cursor, &launch->niced) ||
+        read_number(cursor, &nice) || nice < -40 || nice > 40 ||
+        read_number(cursor, &launch->memory_limit) || launch->memory_limit < 0 ||
+        read_number(cursor, &launch->cpu_limit) || launch->cpu_limit < 0 ||
+        read_number(cursor, &launch->file_limit) || launch->file_limit < 0 ||
+        read_flag(cursor, &launch->perfstat) || **cursor != '\n') {
+        return 1;
+    }
+    launch->nice = (int)nice;
+    (*cursor)++;
+    return read_bytes(cursor, end, launch->cpus, sizeof(launch->cpus));
+}
+
+/* Function: load_plan
+ * --------------------
+ * Loads a persisted plan of the script at path, if there is one and it is
+ * still current.
+ *
+ * returns: the plan, or NULL if there is no usable persisted plan
+ */
+static plan *load_plan(const char *path, const struct stat *st) {
+    char file_path[PATH_MAX];
+    if (plan_file_path(path, file_path, sizeof(file_path)) != 0) {
+        return NULL;
+    }
+
+    FILE *fp = fopen(file_path, "r");
+    if (fp == NULL) {
+        return NULL;
+    }
+    struct stat file_st;
+    if (fstat(fileno(fp), &file_st) != 0) {
+        fclose(fp);
+        return NULL;
+    }
+
+    plan *p = new_plan(path, st);
+    if (p == NULL) {
+        fclose(fp);
+        return NULL;
+    }
+    char *buffer = arena_alloc(&p->strings, file_st.st_size + 1);
+    size_t length = buffer ? fread(buffer, 1, file_st.st_size, fp) : 0;
+    fclose(fp);
+    if (buffer == NULL || length != (size_t)file_st.st_size) {
+        free_plan(p);
+        return NULL;
+    }
+    buffer[length] = '\0';
+
+    char *cursor = buffer;
+    char *end = buffer + length;
+    char *stored_path;
+    char *search_path;
+    long long device, inode, sec, nsec, size, count;
+    long long aliases_device, aliases_inode, aliases_sec, aliases_nsec, aliases_size;
+    size_t magic_length = strlen(PLAN_MAGIC);
+
+    if (length <= magic_length || strncmp(buffer, PLAN_MAGIC, magic_length) != 0 ||
+        buffer[magic_length] != '\n') {
+        free_plan(p);
+        return NULL;
+    }
+    cursor += magic_length + 1;
+
+    if (read_string(&cursor, end, &stored_path) != 0 || stored_path == NULL ||
+        strcmp(stored_path, path) != 0 || read_number(&cursor, &device) ||
+        read_number(&cursor, &inode) || read_number(&cursor, &sec) ||
+        read_number(&cursor, &nsec) || read_number(&cursor, &size) ||
+        read_number(&cursor, &count) || read_number(&cursor, &aliases_device) ||
+        read_number(&cursor, &aliases_inode) || read_number(&cursor, &aliases_sec) ||
+        read_number(&cursor, &aliases_nsec) || read_number(&cursor, &aliases_size) ||
+        *cursor++ != '\n' || read_string(&cursor, end, &search_path) != 0) {
+        free_plan(p);
+        return NULL;
+    }
+
+    // A persisted plan of an older version of the script, or one compiled
+    // by a shell with other aliases or another PATH, is useless
+    file_identity script = {device, inode, {sec, nsec}, size};
+    file_identity aliases = {aliases_device, aliases_inode, {aliases_sec, aliases_nsec}, aliases_size};
+    if (!same_file(&script, &p->script) || !same_file(&aliases, &p->aliases) ||
+        !same_string(search_path, p->search_path)) {
+        free_plan(p);
+        return NULL;
+    }
+
+    for (long long i = 0; i < count; i++) {
+        long long op, connector, background, redirect, input, num_arguments, num_tee_files;
+        plan_entry *entry = append_entry(p);
+        if (entry == NULL || read_number(&cursor, &op) || op < NO_OP || op > OTHER ||
+            read_number(&cursor, &connector) || connector < CHAIN_ALWAYS || connector > CHAIN_OR ||
+            read_number(&cursor, &background) || background < 0 || background > 1 ||
+            read_number(&cursor, &redirect) || redirect < NO_REDIRECT || redirect > REVERSE ||
+            read_number(&cursor, &input) || input < NO_INPUT || input > HERE_DOCUMENT ||
+            read_number(&cursor, &num_arguments) || num_arguments < 0 ||
+            num_arguments >= MAX_ARGUMENTS || read_number(&cursor, &num_tee_files) ||
+            num_tee_files < 0 || num_tee_files > MAX_TEE_TARGETS) {
+            free_plan(p);
+            return NULL;
+        }
+        cursor++; // Skip the newline ending the entry header
+
+        entry->op = op;
+        entry->connector = connector;
+        entry->background = background;
+        entry->redirect = redirect;
+        entry->input = input;
+        entry->num_arguments = num_arguments;
+        entry->num_tee_files = num_tee_files;
+        entry->arguments = arena_alloc(&p->strings, (num_arguments + 1) * sizeof(char *));
+        entry->tee_files = arena_alloc(&p->strings, (num_tee_files + 1) * sizeof(char *));
+        if (entry->arguments == NULL || entry->tee_files == NULL) {
+            free_plan(p);
+            return NULL;
+        }
+        for (int j = 0; j < num_arguments; j++) {
+            if (read_string(&cursor, end, &entry->arguments[j]) != 0) {
+                free_plan(p);
+                return NULL;
+            }
+        }
+        entry->arguments[num_arguments] = NULL;
+        if (read_string(&cursor, end, &entry->output_file) != 0) {
+            free_plan(p);
+            return NULL;
+        }
+        for (int j = 0; j < num_tee_files; j++) {
+            if (read_string(&cursor, end, &entry->tee_files[j]) != 0 || entry->tee_files[j] == NULL) {
+                free_plan(p);
+                return NULL;
+            }
+        }
+        if (read_string(&cursor, end, &entry->input_source) != 0 ||
+            read_string(&cursor, end, &entry->document) != 0 ||
+            read_string(&cursor, end, &entry->executable) != 0 ||
+            read_string(&cursor, end, &entry->source) != 0 ||
+            read_launch(&cursor, end, &entry->launch) != 0) {
+            free_plan(p);
+            return NULL;
+        }
+    }
+
+    return p;
+}
+
+/* Function: run_plan
+ * --------------------
+ * Executes every entry of a compiled script in order. Background jobs
+ * that finished are reported between entries, as at the prompt, so their
+ * slots in the job table are free again.
+ *
+ * returns: the exit status of the last command
+ */
+static int run_plan(plan *p) {
+    int status = 0;
+    p->active++;
+    for (int i = 0; i < p->count; i++) {
+        report_finished_jobs();
+        status = run_entry(&p->entries[i], status);
+    }
+    p->active--;
+    return status;
+}
+
+/* Function: run_script
+ * --------------------
+ * Runs a script file, one command per line. The first run of a script
+ * compiles each line right before executing it, so aliases defined by
+ * earlier lines apply to later ones. The result is kept as a plan keyed by
+ * the script's path, inode and mtime, the version of .aliases and PATH;
+ * running the unchanged script again under the same aliases and PATH
+ * replays the plan without alias substitution, tokenizing, parsing or PATH
+ * lookups. A script that defines aliases changes .aliases and so is
+ * compiled again on its next run. If MYSHELL_PLAN_DIR is set, plans are also persisted there and
+ * reused by later shells.
+ *
+ * Lines starting with '#' are comments. Background jobs that finished are
+ * reported between lines, as at the prompt.
+ *
+ * path: the path of the script
+ *
+ * returns: the exit status of the last command, or 1 if the script could
+ * not be read
+ */
+int run_script(const char *path) {
+    char canonical_path[PATH_MAX];
+    struct stat st;
+
+    if (realpath(path, canonical_path) == NULL || stat(canonical_path, &st) != 0) {
+        printf("Error: Unable to open script %s.\n", path);
+        return 1;
+    }
+
+    // Replay a compiled plan if the script did not change
+    int index = find_plan(canonical_path);
+    if (index >= 0 && plan_is_current(plans[index], &st)) {
+        return run_plan(plans[index]);
+    }
+    plan *p = load_plan(canonical_path, &st);
+    if (p != NULL) {
+        cache_plan(p);
+        index = find_plan(canonical_path);
+        if (index >= 0 && plans[index] == p) {
+            return run_plan(p);
+        }
+        // The plan could not be cached, compile and run the script instead
+    }
+
+    FILE *file = fopen(canonical_path, "r");
+    if (file == NULL) {
+        printf("Error: Unable to open script %s.\n", path);
+        return 1;
+    }
+
+    p = new_plan(canonical_path, &st);
+    if (p == NULL) {
+        fclose(file);
+        printf("Error: Memory allocation failed.\n");
+        return 1;
+    }
+
+    // Compile and run the script line by line
+    char line[MAX_INPUT_LENGTH];
+    int status = 0;
+    int compiled = 1; // 0 once compiling failed, the rest runs uncompiled
+    p->active++;
+    while (fgets(line, sizeof(line), file)) {
+        line[strcspn(line, "\n")] = '\0';
+        if (line[0] == '#') {
+            continue;
+        }
+        report_finished_jobs();
+
+        // A here document's body follows its line in the script
+        char delimiter[MAX_TOKEN_LENGTH];
+        char *document = NULL;
+        if (find_here_document(line, delimiter, sizeof(delimiter))) {
+            script_reader reader = {file, NULL, 0};
+            document = read_here_document(delimiter, read_script_line, &reader, &p->strings);
+            free(reader.line);
+        }
+
+        int count = compiled ? compile_line(p, line, document) : -1;
+        if (count < 0) {
+            // Out of memory: drop the incomplete plan and run the line
+            // the way the interactive loop would
+            compiled = 0;
+            char output[MAX_INPUT_LENGTH];
+            replace_alias_in_command(line, output, MAX_INPUT_LENGTH);
+            int line_status = run_line(output, document);
+            if (line_status != -1) {
+                status = line_status;
+            }
+            continue;
+        }
+        for (int i = p->count - count; i < p->count; i++) {
+            status = run_entry(&p->entries[i], status);
+        }
+    }
+    p->active--;
+    fclose(file);
+
+    if (!compiled) {
+        free_plan(p);
+        return status;
+    }
+    save_plan(p);
+    cache_plan(p);
+    return status;
+}
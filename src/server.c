@@ -0,0 +1,301 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "../lib/alias.h"
+#include "../lib/executor.h"
+#include "../lib/jobs.h"
+#include "../lib/redirect.h"
+#include "../lib/server.h"
+#include "../lib/tokenize.h"
+#include "../lib/uring.h"
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+#define MAX_CONNECTIONS MAX_JOBS // Every request is a job of the server
+
+/* A client whose request is being run by a worker */
+typedef struct connection {
+    int fd;
+    job *worker;
+} connection;
+
+static volatile sig_atomic_t stopping = 0;
+
+/* Function: stop_server
+ * --------------------
+ * Handles SIGINT and SIGTERM: the server stops accepting clients, answers
+ * the requests that are running and exits.
+ */
+static void stop_server(int signal) {
+    (void)signal;
+    stopping = 1;
+}
+
+/* Function: open_server_socket
+ * --------------------
+ * Creates the listening Unix socket, replacing a stale socket file.
+ *
+ * returns: the socket, or -1 on error
+ */
+static int open_server_socket(const char *path) {
+    struct sockaddr_un address;
+    if (strlen(path) >= sizeof(address.sun_path)) {
+        printf("Error: Socket path too long: %s\n", path);
+        return -1;
+    }
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        perror("socket");
+        return -1;
+    }
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+    unlink(path);
+    if (bind(fd, (struct sockaddr *)&address, sizeof(address)) != 0 || listen(fd, SERVER_BACKLOG) != 0) {
+        perror(path);
+        close(fd);
+        return -1;
+    }
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+    return fd;
+}
+
+/* Function: receive_request
+ * --------------------
+ * Reads a request and the client's descriptors from a connection.
+ *
+ * line: the buffer for the command line, MAX_INPUT_LENGTH bytes
+ * fds: receives the client's stdin, stdout and stderr
+ *
+ * returns: 0 on success, -1 if the request is malformed
+ */
+static int receive_request(int fd, char *line, int fds[SERVER_FDS]) {
+    server_request request;
+    char control[CMSG_SPACE(SERVER_FDS * sizeof(int))];
+    struct iovec vector = {&request, sizeof(request)};
+    struct msghdr message;
+    memset(&message, 0, sizeof(message));
+    message.msg_iov = &vector;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+
+    ssize_t received;
+    while ((received = recvmsg(fd, &message, 0)) < 0 && errno == EINTR) {
+    }
+    struct cmsghdr *header = received > 0 ? CMSG_FIRSTHDR(&message) : NULL;
+    if (header == NULL || header->cmsg_level != SOL_SOCKET || header->cmsg_type != SCM_RIGHTS ||
+        header->cmsg_len != CMSG_LEN(SERVER_FDS * sizeof(int))) {
+        return -1;
+    }
+    memcpy(fds, CMSG_DATA(header), SERVER_FDS * sizeof(int));
+
+    // The header arrives whole with its descriptors, the line may follow later
+    size_t length = received;
+    while (length < sizeof(request)) {
+        ssize_t more = read(fd, (char *)&request + length, sizeof(request) - length);
+        if (more <= 0) {
+            return -1;
+        }
+        length += more;
+    }
+    if (request.magic != SERVER_MAGIC || request.length >= MAX_INPUT_LENGTH) {
+        return -1;
+    }
+    length = 0;
+    while (length < request.length) {
+        ssize_t more = read(fd, line + length, request.length - length);
+        if (more <= 0) {
+            return -1;
+        }
+        length += more;
+    }
+    line[length] = '\0';
+    return 0;
+}
+
+/* Function: read_client_line
+ * --------------------
+ * Reads a line of a here document from the client's stdin.
+ *
+ * returns: the line without its newline, or NULL at the end of the input
+ */
+static char *read_client_line(void *context) {
+    (void)context;
+    static char *line = NULL;
+    static size_t capacity = 0;
+    ssize_t length = getline(&line, &capacity, stdin);
+    if (length < 0) {
+        return NULL;
+    }
+    if (length > 0 && line[length - 1] == '\n') {
+        line[length - 1] = '\0';
+    }
+    return line;
+}
+
+/* Function: serve_connection
+ * --------------------
+ * Runs in a worker forked from the server: takes over the client's stdin,
+ * stdout and stderr and runs the command line like the prompt would. The
+ * worker starts with the server's state (aliases, PATH, plan cache) and
+ * none of its startup cost. It never returns; its exit status is the
+ * status of the line, which the server sends to the client.
+ */
+static void serve_connection(int fd) {
+    reset_jobs();
+    reset_uring();
+    signal(SIGINT, SIG_DFL);
+    signal(SIGTERM, SIG_DFL);
+
+    char line[MAX_INPUT_LENGTH];
+    int fds[SERVER_FDS];
+    if (receive_request(fd, line, fds) != 0) {
+        _exit(2);
+    }
+    close(fd);
+    for (int i = 0; i < SERVER_FDS; i++) {
+        dup2(fds[i], i);
+        close(fds[i]);
+    }
+
+    char output[MAX_INPUT_LENGTH];
+    replace_alias_in_command(line, output, MAX_INPUT_LENGTH);
+
+    char delimiter[MAX_TOKEN_LENGTH];
+    arena document = {0};
+    char *body = NULL;
+    if (find_here_document(output, delimiter, sizeof(delimiter))) {
+        body = read_here_document(delimiter, read_client_line, NULL, &document);
+    }
+
+    int status = run_line(output, body);
+    fflush(stdout);
+    fflush(stderr);
+    _exit(status < 0 ? 0 : status);
+}
+
+/* Function: accept_clients
+ * --------------------
+ * Accepts the waiting clients and forks a worker for each. The server
+ * never reads from a client itself, so a slow client only holds up its
+ * own worker.
+ *
+ * returns: the new number of connections
+ */
+static int accept_clients(int listen_fd, connection connections[], int count) {
+    while (count < MAX_CONNECTIONS) {
+        int fd = accept(listen_fd, NULL, NULL);
+        if (fd < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                perror("accept");
+            }
+            break;
+        }
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+        fflush(stdout);
+        pid_t pid = fork();
+        if (pid == 0) {
+            close(listen_fd);
+            for (int i = 0; i < count; i++) {
+                close(connections[i].fd);
+            }
+            serve_connection(fd);
+        }
+        if (pid < 0) {
+            perror("Fork failed");
+            close(fd);
+            continue;
+        }
+
+        // The supervisor reaps the worker and keeps its exit status
+        command request;
+        memset(&request, 0, sizeof(request));
+        request.op = OTHER;
+        request.arguments[request.num_arguments++] = "request";
+        job *worker = add_job(pid, &request, NULL, NULL);
+        if (worker == NULL) {
+            // Cannot happen while connections are capped at MAX_JOBS
+            printf("myshell: too many jobs, %d is not supervised\n", (int)pid);
+            close(fd);
+            continue;
+        }
+        connections[count].fd = fd;
+        connections[count].worker = worker;
+        count++;
+    }
+    return count;
+}
+
+/* Function: run_server
+ * --------------------
+ * Serves command lines on a Unix socket ('myshell --serve PATH') until
+ * SIGINT or SIGTERM. Each request runs in a worker forked from this
+ * already initialized shell, supervised by the same event loop as
+ * background jobs; when the worker exits, its status goes back to the
+ * client. Requests run concurrently, up to MAX_CONNECTIONS at a time;
+ * further clients wait in the listen backlog.
+ *
+ * returns: 0 after a clean shutdown, 1 if the socket cannot be opened
+ */
+int run_server(const char *socket_path) {
+    int listen_fd = open_server_socket(socket_path);
+    if (listen_fd < 0) {
+        return 1;
+    }
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = stop_server; // No SA_RESTART: wake the event loop
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+
+    printf("myshell: serving on %s\n", socket_path);
+    fflush(stdout);
+
+    connection connections[MAX_CONNECTIONS];
+    int count = 0;
+    while (!stopping || count > 0) {
+        int accepting = !stopping && count < MAX_CONNECTIONS;
+        if (wait_for_activity(accepting ? listen_fd : -1, -1) && accepting) {
+            count = accept_clients(listen_fd, connections, count);
+        }
+
+        // Answer the clients whose workers finished
+        for (int i = 0; i < count; i++) {
+            if (connections[i].worker->state != JOB_DONE) {
+                continue;
+            }
+            server_reply reply;
+            reply.status = wait_for_job(connections[i].worker);
+            if (send(connections[i].fd, &reply, sizeof(reply), MSG_NOSIGNAL) != sizeof(reply) && errno != EPIPE) {
+                perror("send");
+            }
+            close(connections[i].fd);
+            connections[i--] = connections[--count];
+        }
+
+        // Free the slots of background jobs that finished between requests
+        report_finished_jobs();
+    }
+
+    close(listen_fd);
+    unlink(socket_path);
+    return 0;
+}
@@ -0,0 +1,275 @@
+#ifdef __linux__
+#define _GNU_SOURCE
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../lib/executor.h"
+#include "../lib/jobs.h"
+#include "../lib/substitute.h"
+
+#define SINK_READ_SIZE 65536
+
+/* The read end of the pipe the shell's stdout points into while a $(...)
+ * runs, and the growable buffer it is drained into */
+typedef struct output_sink {
+    int fd;
+    arena *strings;
+    arena_buffer *buffer;
+    int result; // 0 once drained to end of file, -1 on error
+} output_sink;
+
+static int substitution_depth = 0;
+
+/* Function: find_closing
+ * --------------------
+ * Finds the parenthesis that ends a command substitution.
+ *
+ * start: the "$(" that opens the substitution
+ *
+ * returns: the matching ')', or NULL if the substitution is not closed
+ */
+static const char *find_closing(const char *start) {
+    int depth = 0;
+    for (const char *c = start + 1; *c != '\0'; c++) {
+        if (*c == '(') {
+            depth++;
+        } else if (*c == ')' && --depth == 0) {
+            return c;
+        }
+    }
+    return NULL;
+}
+
+/* Function: has_substitution
+ * --------------------
+ * returns: 1 if a token contains a complete $(...), 0 otherwise
+ */
+int has_substitution(const char *token) {
+    const char *start = strstr(token, "$(");
+    return start != NULL && find_closing(start) != NULL;
+}
+
+/* Function: in_substitution
+ * --------------------
+ * returns: 1 while the shell runs the command of a $(...), 0 otherwise
+ */
+int in_substitution(void) {
+    return substitution_depth > 0;
+}
+
+/* Function: append_bytes
+ * --------------------
+ * Appends bytes to an arena buffer.
+ *
+ * returns: 0 on success, -1 if allocation failed
+ */
+static int append_bytes(arena *words, arena_buffer *buffer, const char *bytes, size_t length) {
+    char *space = arena_buffer_reserve(words, buffer, length + 1);
+    if (space == NULL) {
+        return -1;
+    }
+    memcpy(space, bytes, length);
+    buffer->length += length;
+    return 0;
+}
+
+/* Function: drain_output_sink
+ * --------------------
+ * Reads a sink's pipe into its buffer until the last writer is gone. Runs
+ * on its own thread for the whole substitution, so builtins writing
+ * in-process never fill the pipe. Only this thread touches the buffer
+ * until it is joined.
+ *
+ * context: the output_sink
+ */
+static void *drain_output_sink(void *context) {
+    output_sink *sink = context;
+    sink->result = -1;
+    while (1) {
+        char *space = arena_buffer_reserve(sink->strings, sink->buffer, SINK_READ_SIZE);
+        if (space == NULL) {
+            break;
+        }
+        ssize_t num_read = read(sink->fd, space, SINK_READ_SIZE);
+        if (num_read > 0) {
+            sink->buffer->length += num_read;
+        } else if (num_read == 0) {
+            sink->result = 0;
+            break;
+        } else if (errno != EINTR) {
+            break;
+        }
+    }
+    if (sink->result < 0) {
+        // Keep reading so that writers are not blocked forever
+        char discard[4096];
+        ssize_t num_read;
+        while ((num_read = read(sink->fd, discard, sizeof(discard))) > 0 || (num_read < 0 && errno == EINTR)) {
+        }
+    }
+    return NULL;
+}
+
+/* Function: capture_output
+ * --------------------
+ * Runs the command of a $(...) and appends its stdout, minus trailing
+ * newlines, to a buffer. The shell's own stdout is pointed at a pipe for
+ * the duration, so external commands go through the normal spawn path and
+ * builtins run in-process, both writing into the pipe. A thread drains
+ * the pipe into the buffer meanwhile, so output of any size fits.
+ *
+ * text: the command, not null-terminated
+ * length: the length of the command
+ * words: the arena the buffer lives in
+ * buffer: the buffer to append to
+ *
+ * returns: 0 on success, -1 if the output could not be captured
+ */
+static int capture_output(const char *text, size_t length, arena *words, arena_buffer *buffer) {
+    char line[MAX_INPUT_LENGTH];
+    snprintf(line, sizeof(line), "%.*s", (int)length, text);
+
+    int pipefd[2];
+    if (pipe(pipefd) == -1) {
+        perror("pipe");
+        return -1;
+    }
+    fcntl(pipefd[0], F_SETFD, FD_CLOEXEC);
+    fcntl(pipefd[1], F_SETFD, FD_CLOEXEC);
+
+    size_t start = buffer->length;
+    output_sink sink = {pipefd[0], words, buffer, 0};
+    pthread_t drainer;
+    if (pthread_create(&drainer, NULL, drain_output_sink, &sink) != 0) {
+        fprintf(stderr, "myshell: cannot start a thread for $(...)\n");
+        close(pipefd[0]);
+        close(pipefd[1]);
+        return -1;
+    }
+
+    fflush(stdout);
+    int saved_stdout = fcntl(STDOUT_FILENO, F_DUPFD_CLOEXEC, 0);
+    int result = 0;
+    if (saved_stdout >= 0) {
+        dup2(pipefd[1], STDOUT_FILENO);
+        close(pipefd[1]);
+
+        substitution_depth++;
+        run_line(line, NULL);
+        substitution_depth--;
+
+        fflush(stdout);
+        dup2(saved_stdout, STDOUT_FILENO);
+        close(saved_stdout);
+    } else {
+        perror("dup");
+        close(pipefd[1]);
+        result = -1;
+    }
+
+    // Our end of the pipe is closed, the thread ends with the last writer
+    pthread_join(drainer, NULL);
+    close(pipefd[0]);
+    if (sink.result < 0) {
+        result = -1;
+    }
+
+    while (buffer->length > start && buffer->data[buffer->length - 1] == '\n') {
+        buffer->length--;
+    }
+    return result;
+}
+
+/* Function: expand_substitutions
+ * --------------------
+ * Replaces every $(...) in the tokens with the output of its command. The
+ * output is captured into an arena buffer, then split at whitespace in
+ * place, and the pieces go straight into the token array. Substitutions in
+ * double quotes are not split. The arguments of 'alias' are left alone.
+ * Words of substitutions are marked TOKEN_SUBSTITUTED: they are not
+ * expanded as globs, and they belong to the arena rather than the tokens.
+ *
+ * tokens: the tokens from tokenize_words(), replaced in place
+ * quoted: the flags from tokenize_words(), kept in step with tokens
+ * tokenCount: the number of tokens
+ * max_tokens: the number of tokens that fit, not counting the terminating
+ * NULL
+ * words: the arena the substituted words are stored in
+ *
+ * returns: the new number of tokens, or -1 if the words do not fit. The
+ * tokens are freed in that case.
+ */
+int expand_substitutions(char *tokens[], int quoted[], int tokenCount, int max_tokens, arena *words) {
+    if (tokenCount == 0 || strcmp(tokens[0], "alias") == 0) {
+        return tokenCount;
+    }
+
+    for (int i = 0; i < tokenCount; i++) {
+        if ((quoted[i] & TOKEN_SUBSTITUTED) || !has_substitution(tokens[i])) {
+            continue;
+        }
+
+        // Build the whole token, literal parts and outputs, in one buffer
+        arena_buffer buffer = {0};
+        const char *cursor = tokens[i];
+        int failed = 0;
+        while (*cursor != '\0' && !failed) {
+            const char *start = strstr(cursor, "$(");
+            const char *end = start != NULL ? find_closing(start) : NULL;
+            size_t literal = end != NULL ? (size_t)(start - cursor) : strlen(cursor);
+            failed = append_bytes(words, &buffer, cursor, literal) != 0;
+            if (end == NULL) {
+                break;
+            }
+            failed = failed || capture_output(start + 2, end - start - 2, words, &buffer) != 0;
+            cursor = end + 1;
+        }
+        if (failed || arena_buffer_reserve(words, &buffer, 1) == NULL) {
+            printf("myshell: command substitution failed: %s\n", tokens[i]);
+            free_token_words(tokens, quoted, tokenCount);
+            return -1;
+        }
+        buffer.data[buffer.length] = '\0';
+
+        char *split[MAX_TOKENS];
+        int count = 0;
+        int flags = quoted[i] & TOKEN_QUOTED;
+        if (flags) {
+            split[count++] = buffer.data;
+        } else {
+            char *state = NULL;
+            for (char *word = strtok_r(buffer.data, " \t\n", &state);
+                 word != NULL && count <= max_tokens;
+                 word = strtok_r(NULL, " \t\n", &state)) {
+                split[count++] = word;
+            }
+        }
+
+        if (tokenCount - 1 + count > max_tokens) {
+            printf("myshell: too many words from %s\n", tokens[i]);
+            free_token_words(tokens, quoted, tokenCount);
+            return -1;
+        }
+
+        // Move the words in place of the token
+        free(tokens[i]);
+        memmove(tokens + i + count, tokens + i + 1, (tokenCount - i - 1) * sizeof(char *));
+        memmove(quoted + i + count, quoted + i + 1, (tokenCount - i - 1) * sizeof(int));
+        memcpy(tokens + i, split, count * sizeof(char *));
+        for (int j = 0; j < count; j++) {
+            quoted[i + j] = flags | TOKEN_SUBSTITUTED;
+        }
+        tokenCount += count - 1;
+        i += count - 1;
+    }
+
+    tokens[tokenCount] = NULL;
+    return tokenCount;
+}
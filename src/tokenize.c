@@ -15,6 +15,25 @@
  * returns: the number of tokens
  */
 int tokenize(char *input, char *tokens[MAX_TOKENS]) {
+    return tokenize_words(input, tokens, NULL);
+}
+
+/* Function:  tokenize_words
+ * --------------------
+ * Tokenizes the input string like tokenize(), and records which tokens were
+ * written in double quotes, so that later stages can leave them untouched.
+ * A command substitution $(...) is kept whole inside its token, spaces,
+ * quotes and nested substitutions included. Unquoted ';', '&&', '||' and
+ * the pipe '|' are tokens of their own even without spaces around them;
+ * the '|' of '>|' stays part of that operator.
+ *
+ * input: the string to tokenize
+ * tokens: the array to store the tokens in
+ * quoted: the array to store the quote flags in, or NULL
+ *
+ * returns: the number of tokens
+ */
+int tokenize_words(char *input, char *tokens[MAX_TOKENS], int quoted[MAX_TOKENS]) {
     int tokenCount = 0;
     int inQuotes = 0;
     char *token = malloc(MAX_TOKEN_LENGTH);
@@ -26,10 +45,32 @@ int tokenize(char *input, char *tokens[MAX_TOKENS]) {
     }
 
     for (int i = 0; i < length; i++) {
+        if (input[i] == '$' && input[i + 1] == '(') {
+            int depth = 0;
+            if (tokenIndex < MAX_TOKEN_LENGTH - 1) {
+                token[tokenIndex++] = input[i];
+            }
+            i++;
+            do {
+                if (input[i] == '(') {
+                    depth++;
+                } else if (input[i] == ')') {
+                    depth--;
+                }
+                if (tokenIndex < MAX_TOKEN_LENGTH - 1) {
+                    token[tokenIndex++] = input[i];
+                }
+            } while (depth > 0 && ++i < length);
+            continue;
+        }
+
         if (input[i] == '"') {
             inQuotes = !inQuotes;
             if (!inQuotes) {
                 token[tokenIndex] = '\0';
+                if (quoted) {
+                    quoted[tokenCount] = TOKEN_QUOTED;
+                }
                 tokens[tokenCount++] = token;
                 token = malloc(MAX_TOKEN_LENGTH);
                 tokenIndex = 0;
@@ -40,9 +81,46 @@ int tokenize(char *input, char *tokens[MAX_TOKENS]) {
             continue;
         }
 
+        // Chain operators and pipes end the current word and are tokens of their own
+        int isPipe = input[i] == '|' && input[i + 1] != '|' && (tokenIndex == 0 || token[tokenIndex - 1] != '>');
+        if (!inQuotes && (input[i] == ';' || (input[i] == '&' && input[i + 1] == '&') ||
+                          (input[i] == '|' && input[i + 1] == '|') || isPipe)) {
+            if (tokenCount >= MAX_TOKENS - 2) {
+                break; // No room for the operator and what follows it
+            }
+            if (tokenIndex != 0) {
+                token[tokenIndex] = '\0';
+                if (quoted) {
+                    quoted[tokenCount] = 0;
+                }
+                tokens[tokenCount++] = token;
+                token = malloc(MAX_TOKEN_LENGTH);
+                if (!token) {
+                    return -1; // Memory allocation failed
+                }
+            }
+            int operatorLength = input[i] == ';' || isPipe ? 1 : 2;
+            memcpy(token, input + i, operatorLength);
+            token[operatorLength] = '\0';
+            if (quoted) {
+                quoted[tokenCount] = 0;
+            }
+            tokens[tokenCount++] = token;
+            token = malloc(MAX_TOKEN_LENGTH);
+            tokenIndex = 0;
+            if (!token) {
+                return -1; // Memory allocation failed
+            }
+            i += operatorLength - 1;
+            continue;
+        }
+
         if (input[i] == ' ' && !inQuotes) {
             if (tokenIndex != 0) {
                 token[tokenIndex] = '\0';
+                if (quoted) {
+                    quoted[tokenCount] = 0;
+                }
                 tokens[tokenCount++] = token;
                 token = malloc(MAX_TOKEN_LENGTH);
                 tokenIndex = 0;
@@ -59,6 +137,9 @@ int tokenize(char *input, char *tokens[MAX_TOKENS]) {
 
     if (tokenIndex != 0) {
         token[tokenIndex] = '\0';
+        if (quoted) {
+            quoted[tokenCount] = 0;
+        }
         tokens[tokenCount++] = token;
     } else {
         free(token);
@@ -97,4 +178,23 @@ void free_tokens(char *tokens[MAX_TOKENS], int tokenCount) {
     for (int i = 0; i < tokenCount; i++) {
         free(tokens[i]);
     }
-}
\ No newline at end of file
+}
+
+/* Function:  free_token_words
+ * --------------------
+ * Frees the tokens like free_tokens(), except for the words of command
+ * substitutions, which belong to an arena.
+ *
+ * tokens: the array of tokens to free
+ * quoted: the flags of the tokens
+ * tokenCount: the number of tokens in the array
+ *
+ * returns: void
+ */
+void free_token_words(char *tokens[MAX_TOKENS], const int quoted[MAX_TOKENS], int tokenCount) {
+    for (int i = 0; i < tokenCount; i++) {
+        if (!(quoted[i] & TOKEN_SUBSTITUTED)) {
+            free(tokens[i]);
+        }
+    }
+}
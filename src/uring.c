@@ -0,0 +1,405 @@
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+#include "../lib/redirect.h"
+#include "../lib/uring.h"
+
+#define READ_TAG 0xffffffffULL // user_data of the relay's read
+
+static int backend_selected = 0;
+static io_backend backend = IO_SPLICE;
+
+#ifdef __linux__
+/* A minimal io_uring: the shared rings mapped from the kernel, used
+ * through raw system calls so that no library is needed */
+typedef struct io_ring {
+    int fd; // -1 until set up
+    unsigned *sq_head;
+    unsigned *sq_tail;
+    unsigned *sq_mask;
+    unsigned *sq_array;
+    struct io_uring_sqe *sqes;
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned *cq_mask;
+    struct io_uring_cqe *cqes;
+    void *rings;
+    size_t rings_size;
+    size_t sqes_size;
+    unsigned queued;  // Prepared but not yet submitted
+    char *buffers[URING_BUFFERS];
+    int registered;   // 1 if the buffers are registered with the kernel
+} io_ring;
+
+static io_ring ring = {.fd = -1};
+static int ring_failed = 0;
+
+/* Function: close_ring
+ * --------------------
+ * Unmaps and closes the ring.
+ *
+ * free_buffers: 0 to keep the relay buffers, when the kernel may still
+ * complete requests into them
+ */
+static void close_ring(int free_buffers) {
+    munmap(ring.rings, ring.rings_size);
+    munmap(ring.sqes, ring.sqes_size);
+    close(ring.fd);
+    for (int i = 0; i < URING_BUFFERS && free_buffers; i++) {
+        free(ring.buffers[i]);
+    }
+    memset(&ring, 0, sizeof(ring));
+    ring.fd = -1;
+}
+
+/* Function: abandon_ring
+ * --------------------
+ * Gives up on io_uring after a failed io_uring_enter(): requests may still
+ * be in flight and their completions would be taken for later ones, so the
+ * ring is closed and the shell goes back to the default I/O for good. The
+ * buffers are leaked on purpose, the kernel may still write into them.
+ */
+static void abandon_ring(void) {
+    close_ring(0);
+    ring_failed = 1;
+    if (backend == IO_URING) {
+        backend = IO_SPLICE;
+        fprintf(stderr, "myshell: io_uring failed, using the default I/O\n");
+    }
+}
+
+/* Function: setup_ring
+ * --------------------
+ * Creates the ring and registers the relay buffers, once.
+ *
+ * returns: 0 if io_uring can be used, -1 otherwise
+ */
+static int setup_ring(void) {
+    if (ring.fd >= 0) {
+        return 0;
+    }
+    if (ring_failed) {
+        return -1;
+    }
+
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    int fd = syscall(__NR_io_uring_setup, URING_ENTRIES, &params);
+    if (fd < 0 || !(params.features & IORING_FEAT_SINGLE_MMAP)) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        ring_failed = 1;
+        return -1;
+    }
+
+    // With IORING_FEAT_SINGLE_MMAP both rings share one mapping
+    size_t sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    size_t cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    ring.rings_size = sq_size > cq_size ? sq_size : cq_size;
+    ring.rings = mmap(NULL, ring.rings_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd,
+                      IORING_OFF_SQ_RING);
+    ring.sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring.sqes = mmap(NULL, ring.sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (ring.rings == MAP_FAILED || ring.sqes == MAP_FAILED) {
+        if (ring.rings != MAP_FAILED) {
+            munmap(ring.rings, ring.rings_size);
+        }
+        close(fd);
+        ring_failed = 1;
+        return -1;
+    }
+
+    char *base = ring.rings;
+    ring.sq_head = (unsigned *)(base + params.sq_off.head);
+    ring.sq_tail = (unsigned *)(base + params.sq_off.tail);
+    ring.sq_mask = (unsigned *)(base + params.sq_off.ring_mask);
+    ring.sq_array = (unsigned *)(base + params.sq_off.array);
+    ring.cq_head = (unsigned *)(base + params.cq_off.head);
+    ring.cq_tail = (unsigned *)(base + params.cq_off.tail);
+    ring.cq_mask = (unsigned *)(base + params.cq_off.ring_mask);
+    ring.cqes = (struct io_uring_cqe *)(base + params.cq_off.cqes);
+    ring.queued = 0;
+    ring.fd = fd;
+
+    // Registered buffers are pinned once instead of on every request
+    struct iovec vectors[URING_BUFFERS];
+    for (int i = 0; i < URING_BUFFERS; i++) {
+        ring.buffers[i] = aligned_alloc(4096, URING_CHUNK_SIZE);
+        if (ring.buffers[i] == NULL) {
+            close_ring(1);
+            ring_failed = 1;
+            return -1;
+        }
+        vectors[i].iov_base = ring.buffers[i];
+        vectors[i].iov_len = URING_CHUNK_SIZE;
+    }
+    ring.registered = syscall(__NR_io_uring_register, fd, IORING_REGISTER_BUFFERS, vectors, URING_BUFFERS) == 0;
+    return 0;
+}
+
+/* Function: get_sqe
+ * --------------------
+ * returns: the next free submission queue entry, cleared
+ */
+static struct io_uring_sqe *get_sqe(void) {
+    unsigned tail = *ring.sq_tail + ring.queued;
+    unsigned index = tail & *ring.sq_mask;
+    struct io_uring_sqe *sqe = &ring.sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    ring.sq_array[index] = index;
+    ring.queued++;
+    return sqe;
+}
+
+/* Function: submit_and_wait
+ * --------------------
+ * Hands the prepared entries to the kernel and waits until the given
+ * number of completions is available, in a single system call unless a
+ * signal interrupts it. On any other error the ring is abandoned.
+ *
+ * returns: 0 on success, -1 on error
+ */
+static int submit_and_wait(unsigned completions) {
+    __atomic_store_n(ring.sq_tail, *ring.sq_tail + ring.queued, __ATOMIC_RELEASE);
+    unsigned to_submit = ring.queued;
+    ring.queued = 0;
+
+    while (1) {
+        unsigned ready = __atomic_load_n(ring.cq_tail, __ATOMIC_ACQUIRE) - *ring.cq_head;
+        if (to_submit == 0 && ready >= completions) {
+            return 0;
+        }
+        // The kernel waits until the queue holds that many completions
+        int submitted =
+            syscall(__NR_io_uring_enter, ring.fd, to_submit, completions, IORING_ENTER_GETEVENTS, NULL, 0);
+        if (submitted < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            int error = errno;
+            abandon_ring();
+            errno = error;
+            return -1;
+        }
+        to_submit -= (unsigned)submitted < to_submit ? (unsigned)submitted : to_submit;
+    }
+}
+
+/* Function: next_cqe
+ * --------------------
+ * Takes the oldest completion off the queue.
+ *
+ * returns: 0 with its tag and result filled in, -1 if the queue is empty
+ */
+static int next_cqe(unsigned long long *tag, int *result) {
+    unsigned head = *ring.cq_head;
+    if (head == __atomic_load_n(ring.cq_tail, __ATOMIC_ACQUIRE)) {
+        return -1;
+    }
+    struct io_uring_cqe *cqe = &ring.cqes[head & *ring.cq_mask];
+    *tag = cqe->user_data;
+    *result = cqe->res;
+    __atomic_store_n(ring.cq_head, head + 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+/* Function: prepare_rw
+ * --------------------
+ * Prepares a read or write of a relay buffer, through the registered copy
+ * of the buffer when there is one. Offset -1 uses the file position.
+ */
+static void prepare_rw(int write, int fd, int buffer, size_t length, unsigned long long tag) {
+    struct io_uring_sqe *sqe = get_sqe();
+    if (ring.registered) {
+        sqe->opcode = write ? IORING_OP_WRITE_FIXED : IORING_OP_READ_FIXED;
+        sqe->buf_index = buffer;
+    } else {
+        sqe->opcode = write ? IORING_OP_WRITE : IORING_OP_READ;
+    }
+    sqe->fd = fd;
+    sqe->addr = (unsigned long long)(uintptr_t)ring.buffers[buffer];
+    sqe->len = length;
+    sqe->off = (unsigned long long)-1;
+    sqe->user_data = tag;
+}
+#endif
+
+/* Function: current_io_backend
+ * --------------------
+ * Reads MYSHELL_IO the first time it is called. 'uring' falls back to the
+ * default when the kernel has no io_uring (or it is disabled).
+ *
+ * returns: the backend in use
+ */
+io_backend current_io_backend(void) {
+    if (backend_selected) {
+        return backend;
+    }
+    backend_selected = 1;
+
+    const char *name = getenv("MYSHELL_IO");
+    if (name == NULL || strcmp(name, "splice") == 0) {
+        backend = IO_SPLICE;
+    } else if (strcmp(name, "rw") == 0) {
+        backend = IO_READ_WRITE;
+    } else if (strcmp(name, "uring") == 0) {
+#ifdef __linux__
+        backend = setup_ring() == 0 ? IO_URING : IO_SPLICE;
+#endif
+        if (backend != IO_URING) {
+            fprintf(stderr, "myshell: io_uring is not available, using the default I/O\n");
+        }
+    } else {
+        fprintf(stderr, "myshell: unknown MYSHELL_IO '%s', using the default I/O\n", name);
+    }
+    return backend;
+}
+
+/* Function: reset_uring
+ * --------------------
+ * Drops the ring in a forked copy of the shell: the mapping is shared with
+ * the parent, so the child sets up a ring of its own when it needs one.
+ */
+void reset_uring(void) {
+#ifdef __linux__
+    if (ring.fd >= 0) {
+        close_ring(1);
+    }
+#endif
+}
+
+/* Function: uring_pump_copy
+ * --------------------
+ * Copies what a non-blocking pipe holds into every target file. Each
+ * chunk costs one io_uring_enter() whatever the number of targets: the
+ * writes of one registered buffer to all targets are submitted together
+ * with the read of the next chunk into the other buffer.
+ *
+ * source: the pipe, non-blocking
+ * files: the targets
+ * num_files: the number of targets
+ *
+ * returns: 0 if the source may have more data, 1 at end of file, -1 on
+ * error
+ */
+int uring_pump_copy(int source, const int files[], int num_files) {
+#ifdef __linux__
+    if (setup_ring() != 0 || num_files + 1 > URING_ENTRIES) {
+        errno = ENOSYS;
+        return -1;
+    }
+
+    int current = 0;
+    prepare_rw(0, source, current, URING_CHUNK_SIZE, READ_TAG);
+    if (submit_and_wait(1) != 0) {
+        return -1;
+    }
+    unsigned long long tag;
+    int length;
+    next_cqe(&tag, &length);
+
+    while (1) {
+        if (length == -EINTR) {
+            prepare_rw(0, source, current, URING_CHUNK_SIZE, READ_TAG);
+            if (submit_and_wait(1) != 0) {
+                return -1;
+            }
+            next_cqe(&tag, &length);
+            continue;
+        }
+        if (length == -EAGAIN) {
+            return 0;
+        }
+        if (length <= 0) {
+            errno = -length;
+            return length == 0 ? 1 : -1;
+        }
+
+        for (int i = 0; i < num_files; i++) {
+            prepare_rw(1, files[i], current, length, i);
+        }
+        prepare_rw(0, source, !current, URING_CHUNK_SIZE, READ_TAG);
+        if (submit_and_wait(num_files + 1) != 0) {
+            return -1;
+        }
+
+        int next_length = 0;
+        int failed = 0;
+        for (int i = 0; i < num_files + 1; i++) {
+            int result;
+            next_cqe(&tag, &result);
+            if (tag == READ_TAG) {
+                next_length = result;
+            } else if (result < 0) {
+                errno = -result;
+                failed = 1;
+            } else if (result < length) {
+                // Short writes are rare on files, finish them directly
+                failed |= write_all(files[tag], ring.buffers[current] + result, length - result) != 0;
+            }
+        }
+        if (failed) {
+            return -1;
+        }
+        length = next_length;
+        current = !current;
+    }
+#else
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
+/* Function: uring_readv_all
+ * --------------------
+ * Reads from several non-blocking descriptors at once, one readv each,
+ * with one io_uring_enter() for up to URING_ENTRIES descriptors.
+ *
+ * fds: the descriptors
+ * vectors: where to read from each descriptor
+ * results: receives the bytes read from each, or minus the error number
+ * count: the number of descriptors
+ *
+ * returns: 0 on success, -1 if io_uring cannot be used
+ */
+int uring_readv_all(const int fds[], struct iovec vectors[][2], ssize_t results[], int count) {
+#ifdef __linux__
+    if (setup_ring() != 0) {
+        return -1;
+    }
+    for (int start = 0; start < count; start += URING_ENTRIES) {
+        int batch = count - start < URING_ENTRIES ? count - start : URING_ENTRIES;
+        for (int i = start; i < start + batch; i++) {
+            struct io_uring_sqe *sqe = get_sqe();
+            sqe->opcode = IORING_OP_READV;
+            sqe->fd = fds[i];
+            sqe->addr = (unsigned long long)(uintptr_t)vectors[i];
+            sqe->len = 2;
+            sqe->off = (unsigned long long)-1;
+            sqe->user_data = i;
+        }
+        if (submit_and_wait(batch) != 0) {
+            return -1;
+        }
+        unsigned long long tag;
+        int result;
+        for (int i = 0; i < batch && next_cqe(&tag, &result) == 0; i++) {
+            results[tag] = result;
+        }
+    }
+    return 0;
+#else
+    return -1;
+#endif
+}
@@ -0,0 +1,32 @@
+#include <stdio.h>
+#include <time.h>
+
+#include "../lib/util.h"
+
+/* Function: monotonic_seconds
+ * --------------------
+ * returns: a monotonic time in seconds, for measuring intervals
+ */
+double monotonic_seconds(void) {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+/* Function: write_json_string
+ * --------------------
+ * Writes a string as a JSON string literal.
+ */
+void write_json_string(FILE *file, const char *text) {
+    fputc('"', file);
+    for (const unsigned char *c = (const unsigned char *)text; *c != '\0'; c++) {
+        if (*c == '"' || *c == '\\') {
+            fprintf(file, "\\%c", *c);
+        } else if (*c < 0x20) {
+            fprintf(file, "\\u%04x", *c);
+        } else {
+            fputc(*c, file);
+        }
+    }
+    fputc('"', file);
+}
@@ -0,0 +1,500 @@
+#include <dirent.h>
+#include <errno.h>
+#include <limits.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+
+#include "../lib/executor.h"
+#include "../lib/jobs.h"
+#include "../lib/util.h"
+#include "../lib/watch.h"
+
+#ifdef __linux__
+// Changes that make the command run again
+#define WATCH_MASK (IN_MODIFY | IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO)
+
+/* A directory watched with inotify. A file given to --paths is watched
+ * through its directory, so editors that save by renaming are seen. */
+typedef struct watched_directory {
+    int wd;
+    char *path;
+    char *name; // The only entry that counts, or NULL for the whole tree
+    dev_t dev;  // Identity of the directory, to match ignored files
+    ino_t ino;
+} watched_directory;
+
+/* A file the watched command writes itself, whose changes do not count */
+typedef struct ignored_file {
+    dev_t dev; // The directory it is in
+    ino_t ino;
+    const char *name;
+} ignored_file;
+
+/* The inotify instance of one 'watch' */
+typedef struct watcher {
+    int fd;
+    watched_directory *directories;
+    int count;
+    int capacity;
+    ignored_file ignored[1 + MAX_TEE_TARGETS]; // The redirection targets
+    int num_ignored;
+} watcher;
+
+static volatile sig_atomic_t stopping = 0;
+
+/* Function: stop_watching
+ * --------------------
+ * Handles SIGINT while 'watch' runs: ends the watch instead of the shell.
+ */
+static void stop_watching(int signal) {
+    (void)signal;
+    stopping = 1;
+}
+
+/* Function: ignored_name
+ * --------------------
+ * returns: 1 for hidden entries (.git, editor swap files) and backups
+ * ending in '~', which do not count as changes of a tree
+ */
+static int ignored_name(const char *name) {
+    size_t length = strlen(name);
+    return name[0] == '.' || (length > 0 && name[length - 1] == '~');
+}
+
+/* Function: add_directory
+ * --------------------
+ * Watches one directory.
+ *
+ * name: the entry of the directory to watch, or NULL for all of them
+ *
+ * returns: 0 on success, -1 with errno set
+ */
+static int add_directory(watcher *w, const char *path, const char *name) {
+    struct stat st;
+    if (stat(path, &st) != 0) {
+        return -1;
+    }
+    int wd = inotify_add_watch(w->fd, path, WATCH_MASK);
+    if (wd < 0) {
+        return -1;
+    }
+    if (w->count == w->capacity) {
+        int capacity = w->capacity ? w->capacity * 2 : 16;
+        watched_directory *grown = realloc(w->directories, capacity * sizeof(watched_directory));
+        if (grown == NULL) {
+            return -1;
+        }
+        w->directories = grown;
+        w->capacity = capacity;
+    }
+    watched_directory *directory = &w->directories[w->count];
+    directory->wd = wd;
+    directory->dev = st.st_dev;
+    directory->ino = st.st_ino;
+    directory->path = strdup(path);
+    directory->name = name != NULL ? strdup(name) : NULL;
+    if (directory->path == NULL || (name != NULL && directory->name == NULL)) {
+        free(directory->path);
+        free(directory->name);
+        errno = ENOMEM;
+        return -1;
+    }
+    w->count++;
+    return 0;
+}
+
+/* Function: add_tree
+ * --------------------
+ * Watches a directory and, recursively, its subdirectories except hidden
+ * ones. Subdirectories that vanish meanwhile are skipped.
+ *
+ * returns: 0 on success, -1 if the directory itself cannot be watched
+ */
+static int add_tree(watcher *w, const char *path) {
+    if (add_directory(w, path, NULL) != 0) {
+        return -1;
+    }
+    DIR *dir = opendir(path);
+    if (dir == NULL) {
+        return 0;
+    }
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (ignored_name(entry->d_name)) {
+            continue;
+        }
+        char child[PATH_MAX];
+        if (snprintf(child, sizeof(child), "%s/%s", path, entry->d_name) >= (int)sizeof(child)) {
+            continue;
+        }
+        struct stat st;
+        if (entry->d_type == DT_DIR ||
+            (entry->d_type == DT_UNKNOWN && lstat(child, &st) == 0 && S_ISDIR(st.st_mode))) {
+            add_tree(w, child);
+        }
+    }
+    closedir(dir);
+    return 0;
+}
+
+/* Function: split_path
+ * --------------------
+ * Splits a file's path into its directory and its name.
+ *
+ * directory: receives the directory, "." if the path has none
+ *
+ * returns: the name, or NULL with errno set if the path is too long
+ */
+static const char *split_path(const char *path, char directory[PATH_MAX]) {
+    const char *slash = strrchr(path, '/');
+    if (slash == NULL) {
+        strcpy(directory, ".");
+    } else if (slash == path) {
+        strcpy(directory, "/");
+    } else if (slash - path < PATH_MAX) {
+        memcpy(directory, path, slash - path);
+        directory[slash - path] = '\0';
+    } else {
+        errno = ENAMETOOLONG;
+        return NULL;
+    }
+    return slash != NULL ? slash + 1 : path;
+}
+
+/* Function: add_path
+ * --------------------
+ * Watches a path given to --paths: a directory with its subdirectories,
+ * or a single file.
+ *
+ * returns: 0 on success, -1 with errno set
+ */
+static int add_path(watcher *w, const char *path) {
+    struct stat st;
+    if (stat(path, &st) != 0) {
+        return -1;
+    }
+    if (S_ISDIR(st.st_mode)) {
+        return add_tree(w, path);
+    }
+
+    char directory[PATH_MAX];
+    const char *name = split_path(path, directory);
+    return name != NULL ? add_directory(w, directory, name) : -1;
+}
+
+/* Function: ignore_file
+ * --------------------
+ * Makes changes of a file the command writes itself not count, so that a
+ * redirection target inside the watched tree does not cause endless runs.
+ * The file is matched by the identity of its directory, whatever path the
+ * directory is watched under.
+ */
+static void ignore_file(watcher *w, const char *path) {
+    char directory[PATH_MAX];
+    const char *name = split_path(path, directory);
+    struct stat st;
+    if (name == NULL || stat(directory, &st) != 0 || w->num_ignored == 1 + MAX_TEE_TARGETS) {
+        return;
+    }
+    w->ignored[w->num_ignored++] = (ignored_file){st.st_dev, st.st_ino, name};
+}
+
+/* Function: is_ignored
+ * --------------------
+ * returns: 1 if an entry of a watched directory is an ignored file
+ */
+static int is_ignored(const watcher *w, const watched_directory *directory, const char *name) {
+    for (int i = 0; i < w->num_ignored; i++) {
+        const ignored_file *file = &w->ignored[i];
+        if (file->dev == directory->dev && file->ino == directory->ino && strcmp(file->name, name) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* Function: close_watcher
+ * --------------------
+ * Closes the inotify instance, which removes all of its watches.
+ */
+static void close_watcher(watcher *w) {
+    for (int i = 0; i < w->count; i++) {
+        free(w->directories[i].path);
+        free(w->directories[i].name);
+    }
+    free(w->directories);
+    if (w->fd >= 0) {
+        close(w->fd);
+    }
+}
+
+/* Function: read_changes
+ * --------------------
+ * Reads the pending inotify events. New directories inside a watched tree
+ * are watched too. Changes of the redirection targets do not count.
+ *
+ * changed: receives the path of the first change that counts
+ *
+ * returns: 1 if something that counts changed, 0 otherwise
+ */
+static int read_changes(watcher *w, char *changed, size_t size) {
+    char buffer[65536] __attribute__((aligned(__alignof__(struct inotify_event))));
+    int found = 0;
+    ssize_t length;
+    while ((length = read(w->fd, buffer, sizeof(buffer))) > 0) {
+        for (char *cursor = buffer; cursor < buffer + length;) {
+            struct inotify_event *event = (struct inotify_event *)cursor;
+            cursor += sizeof(struct inotify_event) + event->len;
+
+            if (event->mask & IN_Q_OVERFLOW) {
+                // Events were lost, assume something changed
+                if (!found) {
+                    snprintf(changed, size, "(many files)");
+                }
+                found = 1;
+                continue;
+            }
+            if (event->len == 0) {
+                continue; // IN_IGNORED, the watch of a removed directory is gone
+            }
+            const char *name = event->name;
+            for (int i = 0; i < w->count; i++) {
+                watched_directory *directory = &w->directories[i];
+                if (directory->wd != event->wd) {
+                    continue;
+                }
+                if (directory->name != NULL ? strcmp(directory->name, name) != 0 : ignored_name(name)) {
+                    continue;
+                }
+                if (is_ignored(w, directory, name)) {
+                    break;
+                }
+                char path[PATH_MAX];
+                snprintf(path, sizeof(path), "%s/%s", directory->path, name);
+                if (!found) {
+                    snprintf(changed, size, "%s", path);
+                }
+                found = 1;
+                if (directory->name == NULL && (event->mask & IN_ISDIR) && (event->mask & (IN_CREATE | IN_MOVED_TO))) {
+                    add_tree(w, path);
+                }
+                break;
+            }
+        }
+    }
+    return found;
+}
+
+/* Function: start_run
+ * --------------------
+ * Starts one run of the watched command through the normal spawn path.
+ *
+ * returns: the job of the run, or NULL if it could not be supervised
+ */
+static job *start_run(command *cmd, const char *executable_path) {
+    job *started = NULL;
+    spawn_command(cmd, executable_path, NULL, &started);
+    return started;
+}
+
+/* Function: handle_watch_command
+ * --------------------
+ * Handles the 'watch' builtin:
+ * watch [--paths PATH... --] [--debounce MS] [--queue] cmd [args...]
+ *
+ * Runs cmd, then runs it again whenever something changes under the
+ * paths (the current directory by default), until Ctrl-C. Changes are
+ * reported by inotify, so nothing is polled while the shell waits. A
+ * burst of changes, such as a checkout, waits until the paths have been
+ * quiet for the debounce time (DEFAULT_DEBOUNCE_MS) and then causes one
+ * run. A change while the command is running cancels the run, which is
+ * then started again; with --queue the run finishes and the command runs
+ * once more after it. After each run the time from the change to the
+ * result is printed. Redirections and prefix builtins of the watch apply
+ * to every run, and changes of the redirection targets are ignored.
+ *
+ * returns: the exit status of the last run that finished
+ */
+int handle_watch_command(command *cmd) {
+    const char *paths[MAX_WATCHED_PATHS];
+    int num_paths = 0;
+    long debounce_ms = DEFAULT_DEBOUNCE_MS;
+    int queue = 0;
+
+    int first = 1;
+    while (first < cmd->num_arguments && strncmp(cmd->arguments[first], "--", 2) == 0) {
+        if (strcmp(cmd->arguments[first], "--paths") == 0) {
+            first++;
+            while (first < cmd->num_arguments && strcmp(cmd->arguments[first], "--") != 0) {
+                if (num_paths == MAX_WATCHED_PATHS) {
+                    printf("Error: 'watch' takes at most %d paths.\n", MAX_WATCHED_PATHS);
+                    return 1;
+                }
+                paths[num_paths++] = cmd->arguments[first++];
+            }
+            if (first == cmd->num_arguments || num_paths == 0) {
+                printf("Error: Invalid syntax for 'watch' command.\n");
+                return 2;
+            }
+            first++; // The '--' that ends the paths
+        } else if (strcmp(cmd->arguments[first], "--debounce") == 0 && first + 1 < cmd->num_arguments) {
+            char *end;
+            debounce_ms = strtol(cmd->arguments[first + 1], &end, 10);
+            if (*end != '\0' || end == cmd->arguments[first + 1] || debounce_ms < 0 || debounce_ms > 60000) {
+                printf("Error: Invalid syntax for 'watch' command.\n");
+                return 2;
+            }
+            first += 2;
+        } else if (strcmp(cmd->arguments[first], "--queue") == 0) {
+            queue = 1;
+            first++;
+        } else if (strcmp(cmd->arguments[first], "--") == 0) {
+            first++;
+            break;
+        } else {
+            printf("Error: Invalid syntax for 'watch' command.\n");
+            return 2;
+        }
+    }
+    if (first >= cmd->num_arguments) {
+        printf("Error: Invalid syntax for 'watch' command.\n");
+        return 2;
+    }
+    if (num_paths == 0) {
+        paths[num_paths++] = ".";
+    }
+
+    // The watched command is an external command with the watch's redirections
+    command run = *cmd;
+    run.op = OTHER;
+    run.background = 0;
+    run.num_arguments = cmd->num_arguments - first;
+    memmove(run.arguments, cmd->arguments + first, run.num_arguments * sizeof(char *));
+    for (int i = 0; builtin_names[i] != NULL; i++) {
+        if (strcmp(run.arguments[0], builtin_names[i]) == 0) {
+            printf("Error: '%s' cannot be used with 'watch'.\n", run.arguments[0]);
+            return 1;
+        }
+    }
+    char *found = find_executable(run.arguments[0]);
+    if (found == NULL) {
+        printf("myshell: command not found: %s\n", run.arguments[0]);
+        return 127;
+    }
+    char executable_path[MAX_PATH_LENGTH];
+    snprintf(executable_path, sizeof(executable_path), "%s", found);
+
+    watcher w = {.fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC)};
+    if (w.fd < 0) {
+        perror("inotify_init1");
+        return 1;
+    }
+    for (int i = 0; i < num_paths; i++) {
+        if (add_path(&w, paths[i]) != 0) {
+            fprintf(stderr, "myshell: watch: %s: %s\n", paths[i], strerror(errno));
+            close_watcher(&w);
+            return 1;
+        }
+    }
+    if (run.redirect != NO_REDIRECT) {
+        ignore_file(&w, run.output_file);
+    }
+    for (int i = 0; i < run.num_tee_files; i++) {
+        ignore_file(&w, run.tee_files[i]);
+    }
+
+    struct sigaction action, previous;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = stop_watching; // No SA_RESTART: wake the event loop
+    sigaction(SIGINT, &action, &previous);
+    stopping = 0;
+
+    printf("watch: %d director%s, Ctrl-C to stop\n", w.count, w.count == 1 ? "y" : "ies");
+    fflush(stdout);
+
+    int status = 0;
+    int runs = 0;
+    double changed_at = 0;     // First change not served by a run yet, 0 if none
+    double last_change = 0;    // For the debounce
+    double run_changed_at = 0; // The change the current run serves, 0 for the first run
+    double run_started = monotonic_seconds();
+    char changed[PATH_MAX] = "";
+    int cancelled = 0; // The current run was cancelled by a change
+    job *running = start_run(&run, executable_path);
+    runs++;
+
+    while (!stopping) {
+        int timeout_ms = -1;
+        if (running == NULL && changed_at > 0) {
+            double quiet = monotonic_seconds() - last_change;
+            if (quiet * 1000 >= debounce_ms) {
+                printf("watch: %s changed, running %s\n", changed, run.arguments[0]);
+                fflush(stdout);
+                run_changed_at = changed_at;
+                changed_at = 0;
+                run_started = monotonic_seconds();
+                running = start_run(&run, executable_path);
+                runs++;
+                continue;
+            }
+            timeout_ms = (int)(debounce_ms - quiet * 1000) + 1;
+        }
+
+        char path[PATH_MAX];
+        if (wait_for_activity(w.fd, timeout_ms) && read_changes(&w, path, sizeof(path))) {
+            last_change = monotonic_seconds();
+            if (changed_at == 0) {
+                changed_at = last_change;
+                strcpy(changed, path);
+            }
+            if (!queue && running != NULL && !cancelled) {
+                cancel_job(running);
+                cancelled = 1;
+            }
+        }
+
+        if (running != NULL && running->state == JOB_DONE) {
+            int result = wait_for_job(running);
+            running = NULL;
+            double finished = monotonic_seconds();
+            if (cancelled) {
+                cancelled = 0;
+                printf("watch: run %d cancelled after %.3f s, files changed\n", runs, finished - run_started);
+                if (run_changed_at > 0 && run_changed_at < changed_at) {
+                    changed_at = run_changed_at; // The next run serves that change too
+                }
+            } else if (run_changed_at > 0) {
+                status = result;
+                printf("watch: run %d exited with %d in %.3f s, %.3f s after the change\n", runs, status,
+                       finished - run_started, finished - run_changed_at);
+            } else {
+                status = result;
+                printf("watch: run %d exited with %d in %.3f s\n", runs, status, finished - run_started);
+            }
+            fflush(stdout);
+        }
+    }
+
+    if (running != NULL) {
+        cancel_job(running);
+        wait_for_job(running);
+    }
+    sigaction(SIGINT, &previous, NULL);
+    close_watcher(&w);
+    printf("\nwatch: stopped after %d run%s\n", runs, runs == 1 ? "" : "s");
+    return status;
+}
+#else
+int handle_watch_command(command *cmd) {
+    printf("myshell: watch is not supported on this platform\n");
+    return 1;
+}
+#endif
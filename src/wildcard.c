@@ -0,0 +1,452 @@
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../lib/wildcard.h"
+
+#define SET_HAS(set, c) ((set)[(unsigned char)(c) >> 5] & (1u << ((unsigned char)(c) & 31)))
+#define SET_ADD(set, c) ((set)[(unsigned char)(c) >> 5] |= (1u << ((unsigned char)(c) & 31)))
+
+/* The matches of one word, collected before they replace it */
+typedef struct match_list {
+    char **paths;
+    int count;
+    int capacity;
+} match_list;
+
+// Directory listings of this session, reused while their mtime is unchanged
+static cached_listing listing_cache[MAX_LISTING_CACHE];
+static int next_evicted = 0;
+
+/* Function: has_wildcard
+ * --------------------
+ * Checks whether a word contains any of the glob characters *, ? and [.
+ *
+ * returns: 1 if the word is a pattern, 0 otherwise
+ */
+int has_wildcard(const char *word) {
+    return strpbrk(word, "*?[") != NULL;
+}
+
+/* Function: compile_pattern
+ * --------------------
+ * Compiles a pattern for one path component. '?' accepts any byte, '[...]'
+ * a set of bytes (with ranges and '!' or '^' negation), and '*' separates
+ * segments. A '[' without a closing ']' is a literal.
+ *
+ * pattern: the pattern, not null terminated
+ * length: the length of the pattern
+ * compiled: receives the compiled pattern
+ *
+ * returns: 0 on success, 1 if the pattern is too long
+ */
+int compile_pattern(const char *pattern, size_t length, compiled_pattern *compiled) {
+    compiled->num_elements = 0;
+    compiled->num_segments = 0;
+    compiled->leading_star = length > 0 && pattern[0] == '*';
+    compiled->trailing_star = 0;
+    compiled->match_dot = length > 0 && pattern[0] == '.';
+
+    int segment_open = 0;
+    for (size_t i = 0; i < length; i++) {
+        if (pattern[i] == '*') {
+            segment_open = 0;
+            compiled->trailing_star = 1;
+            continue;
+        }
+        compiled->trailing_star = 0;
+
+        if (compiled->num_elements == MAX_PATTERN_ELEMENTS) {
+            return 1;
+        }
+        uint32_t *set = compiled->elements[compiled->num_elements];
+        memset(set, 0, 8 * sizeof(uint32_t));
+
+        if (pattern[i] == '?') {
+            memset(set, 0xff, 8 * sizeof(uint32_t));
+        } else if (pattern[i] == '[' && i + 2 < length && memchr(pattern + i + 2, ']', length - i - 2)) {
+            size_t j = i + 1;
+            int negate = pattern[j] == '!' || pattern[j] == '^';
+            j += negate;
+            // A ']' right after the opening bracket is part of the set
+            do {
+                if (j + 2 < length && pattern[j + 1] == '-' && pattern[j + 2] != ']') {
+                    for (int c = (unsigned char)pattern[j]; c <= (unsigned char)pattern[j + 2]; c++) {
+                        SET_ADD(set, c);
+                    }
+                    j += 3;
+                } else {
+                    SET_ADD(set, pattern[j]);
+                    j++;
+                }
+            } while (j < length && pattern[j] != ']');
+            if (j >= length) {
+                // Unterminated after all, treat the bracket as a literal
+                memset(set, 0, 8 * sizeof(uint32_t));
+                SET_ADD(set, '[');
+            } else {
+                if (negate) {
+                    for (int k = 0; k < 8; k++) {
+                        set[k] = ~set[k];
+                    }
+                }
+                i = j;
+            }
+        } else {
+            SET_ADD(set, pattern[i]);
+        }
+
+        if (!segment_open) {
+            compiled->segment_start[compiled->num_segments] = compiled->num_elements;
+            compiled->segment_length[compiled->num_segments] = 0;
+            compiled->num_segments++;
+            segment_open = 1;
+        }
+        compiled->segment_length[compiled->num_segments - 1]++;
+        compiled->num_elements++;
+    }
+
+    return 0;
+}
+
+/* Function: match_segment
+ * --------------------
+ * Checks whether a segment matches the name at a given position.
+ */
+static int match_segment(const compiled_pattern *compiled, int segment, const char *name) {
+    const int start = compiled->segment_start[segment];
+    const int length = compiled->segment_length[segment];
+    for (int i = 0; i < length; i++) {
+        if (!SET_HAS(compiled->elements[start + i], name[i])) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/* Function: match_pattern
+ * --------------------
+ * Matches a name against a compiled pattern without backtracking. The
+ * segments before the first and after the last '*' are anchored to the
+ * start and end of the name; every segment in between is matched at its
+ * leftmost position after the previous one, which is always the best
+ * choice, so each segment is searched once.
+ *
+ * returns: 1 if the name matches, 0 otherwise
+ */
+int match_pattern(const compiled_pattern *compiled, const char *name, size_t length) {
+    // Wildcards never match a leading dot
+    if (name[0] == '.' && !compiled->match_dot) {
+        return 0;
+    }
+
+    int first = 0;
+    int last = compiled->num_segments;
+    size_t position = 0;
+    size_t end = length;
+
+    if (compiled->num_segments == 0) {
+        return compiled->leading_star || length == 0;
+    }
+
+    if (!compiled->leading_star) {
+        size_t segment_length = compiled->segment_length[0];
+        if (segment_length > length || !match_segment(compiled, 0, name)) {
+            return 0;
+        }
+        position = segment_length;
+        first = 1;
+        if (compiled->num_segments == 1 && !compiled->trailing_star) {
+            return position == length; // No '*' at all
+        }
+    }
+
+    if (!compiled->trailing_star && last > first) {
+        size_t segment_length = compiled->segment_length[last - 1];
+        if (segment_length > end - position || !match_segment(compiled, last - 1, name + end - segment_length)) {
+            return 0;
+        }
+        end -= segment_length;
+        last--;
+    }
+
+    for (int segment = first; segment < last; segment++) {
+        size_t segment_length = compiled->segment_length[segment];
+        while (position + segment_length <= end && !match_segment(compiled, segment, name + position)) {
+            position++;
+        }
+        if (position + segment_length > end) {
+            return 0;
+        }
+        position += segment_length;
+    }
+
+    return 1;
+}
+
+/* Function: get_listing
+ * --------------------
+ * Returns the entries of a directory, reusing the cached listing when the
+ * directory's mtime did not change, so repeated globs cost one stat.
+ *
+ * returns: the listing, or NULL if the directory cannot be read
+ */
+static directory_listing *get_listing(const char *path) {
+    struct stat st;
+    if (stat(path, &st) != 0 || !S_ISDIR(st.st_mode)) {
+        return NULL;
+    }
+    struct timespec mtime = stat_mtime(&st);
+
+    cached_listing *entry = NULL;
+    for (int i = 0; i < MAX_LISTING_CACHE; i++) {
+        if (listing_cache[i].path != NULL && strcmp(listing_cache[i].path, path) == 0) {
+            entry = &listing_cache[i];
+            break;
+        }
+    }
+    if (entry != NULL && entry->mtime.tv_sec == mtime.tv_sec && entry->mtime.tv_nsec == mtime.tv_nsec) {
+        return &entry->listing;
+    }
+
+    if (entry == NULL) {
+        entry = &listing_cache[next_evicted];
+        next_evicted = (next_evicted + 1) % MAX_LISTING_CACHE;
+        free(entry->path);
+        entry->path = strdup(path);
+        if (entry->path == NULL) {
+            free_directory_listing(&entry->listing);
+            return NULL;
+        }
+    }
+    free_directory_listing(&entry->listing);
+
+    int fd = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    int count = fd >= 0 ? list_directory(fd, &entry->listing) : -1;
+    if (fd >= 0) {
+        close(fd);
+    }
+    if (count < 0) {
+        free_directory_listing(&entry->listing);
+        free(entry->path);
+        entry->path = NULL;
+        return NULL;
+    }
+
+    // Only remember listings that are complete
+    entry->mtime = mtime;
+    return &entry->listing;
+}
+
+/* Function: add_match
+ * --------------------
+ * Appends a copy of a path to a match list.
+ *
+ * returns: 0 on success, 1 if allocation failed
+ */
+static int add_match(match_list *matches, const char *path) {
+    if (matches->count == matches->capacity) {
+        int capacity = matches->capacity ? matches->capacity * 2 : 16;
+        char **paths = realloc(matches->paths, capacity * sizeof(char *));
+        if (paths == NULL) {
+            return 1;
+        }
+        matches->paths = paths;
+        matches->capacity = capacity;
+    }
+    matches->paths[matches->count] = strdup(path);
+    if (matches->paths[matches->count] == NULL) {
+        return 1;
+    }
+    matches->count++;
+    return 0;
+}
+
+/* Function: is_directory
+ * --------------------
+ * Checks whether a directory entry is a directory, following symbolic links.
+ */
+static int is_directory(const char *path, unsigned char type) {
+    if (type == DT_DIR) {
+        return 1;
+    }
+    if (type != DT_LNK && type != DT_UNKNOWN) {
+        return 0;
+    }
+    struct stat st;
+    return stat(path, &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+/* Function: expand_components
+ * --------------------
+ * Expands the components of a pattern from left to right. Literal
+ * components are appended as they are, components with wildcards are
+ * matched against the (cached) listing of the directory built so far.
+ *
+ * base: the path expanded so far, with room for PATH_MAX bytes
+ * base_length: the length of base
+ * pattern: the rest of the pattern
+ * checked: 0 if base ends with literal components that may not exist
+ * matches: receives the matching paths
+ *
+ * returns: 0 on success, 1 if allocation failed
+ */
+static int expand_components(char *base, size_t base_length, const char *pattern, int checked, match_list *matches) {
+    while (*pattern == '/') {
+        if (base_length + 1 >= PATH_MAX) {
+            return 0;
+        }
+        base[base_length++] = *pattern++;
+    }
+    base[base_length] = '\0';
+
+    if (*pattern == '\0') {
+        struct stat st;
+        if (checked || lstat(base, &st) == 0) {
+            return add_match(matches, base);
+        }
+        return 0;
+    }
+
+    const char *component_end = strchr(pattern, '/');
+    size_t component_length = component_end ? (size_t)(component_end - pattern) : strlen(pattern);
+    const char *rest = pattern + component_length;
+
+    // Literal components need no directory listing
+    if (memchr(pattern, '*', component_length) == NULL && memchr(pattern, '?', component_length) == NULL &&
+        memchr(pattern, '[', component_length) == NULL) {
+        if (base_length + component_length >= PATH_MAX) {
+            return 0;
+        }
+        memcpy(base + base_length, pattern, component_length);
+        return expand_components(base, base_length + component_length, rest, 0, matches);
+    }
+
+    compiled_pattern *compiled = malloc(sizeof(compiled_pattern));
+    if (compiled == NULL) {
+        return 1;
+    }
+    if (compile_pattern(pattern, component_length, compiled) != 0) {
+        free(compiled);
+        return 0;
+    }
+
+    directory_listing *listing = get_listing(base_length ? base : ".");
+    if (listing == NULL) {
+        free(compiled);
+        return 0;
+    }
+
+    // Copy the matching names first, nested globs may evict the listing
+    match_list names = {0};
+    int status = 0;
+    for (int i = 0; i < listing->count && status == 0; i++) {
+        char *name = listing->names[i];
+        if (match_pattern(compiled, name, strlen(name))) {
+            if (*rest != '\0') {
+                // Only directories can have further components
+                char path[PATH_MAX];
+                snprintf(path, sizeof(path), "%.*s%s", (int)base_length, base, name);
+                if (!is_directory(path, listing->types[i])) {
+                    continue;
+                }
+            }
+            status = add_match(&names, name);
+        }
+    }
+    free(compiled);
+
+    for (int i = 0; i < names.count; i++) {
+        size_t name_length = strlen(names.paths[i]);
+        if (status == 0 && base_length + name_length < PATH_MAX) {
+            memcpy(base + base_length, names.paths[i], name_length);
+            status = expand_components(base, base_length + name_length, rest, 1, matches);
+        }
+        free(names.paths[i]);
+    }
+    free(names.paths);
+    base[base_length] = '\0';
+
+    return status;
+}
+
+/* Function: compare_paths
+ * --------------------
+ * qsort() comparator that sorts matches alphabetically.
+ */
+static int compare_paths(const void *a, const void *b) {
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+/* Function: expand_wildcards
+ * --------------------
+ * Replaces every token containing *, ? or [...] with the sorted paths it
+ * matches. Tokens without matches are kept as they are. Quoted tokens, words
+ * of command substitutions, the arguments of 'alias' and the targets of
+ * redirections are never expanded.
+ *
+ * tokens: the tokens from tokenize_words(), replaced in place
+ * quoted: the quote flags from tokenize_words(), kept in step with tokens
+ * tokenCount: the number of tokens
+ * max_tokens: the number of tokens that fit, not counting the terminating
+ * NULL
+ *
+ * returns: the new number of tokens, or -1 if the matches do not fit. The
+ * tokens are freed in that case.
+ */
+int expand_wildcards(char *tokens[], int quoted[], int tokenCount, int max_tokens) {
+    if (tokenCount == 0 || strcmp(tokens[0], "alias") == 0) {
+        return tokenCount;
+    }
+
+    for (int i = 0; i < tokenCount; i++) {
+        if (quoted[i] || !has_wildcard(tokens[i]) ||
+            (i > 0 && (strcmp(tokens[i - 1], ">") == 0 || strcmp(tokens[i - 1], ">>") == 0 ||
+                       strcmp(tokens[i - 1], ">>>") == 0 || strcmp(tokens[i - 1], ">|") == 0 ||
+                       strcmp(tokens[i - 1], "<") == 0 || strcmp(tokens[i - 1], "<<<") == 0 ||
+                       strcmp(tokens[i - 1], "<<") == 0))) {
+            continue;
+        }
+
+        char base[PATH_MAX];
+        match_list matches = {0};
+        int status = expand_components(base, 0, tokens[i], 0, &matches);
+
+        if (status == 0 && matches.count > 0 && tokenCount - 1 + matches.count > max_tokens) {
+            printf("myshell: too many matches for %s\n", tokens[i]);
+            status = 1;
+        }
+        if (status != 0 || matches.count == 0) {
+            for (int j = 0; j < matches.count; j++) {
+                free(matches.paths[j]);
+            }
+            free(matches.paths);
+            if (status != 0) {
+                free_token_words(tokens, quoted, tokenCount);
+                return -1;
+            }
+            continue;
+        }
+
+        qsort(matches.paths, matches.count, sizeof(char *), compare_paths);
+
+        // Make room for the matches and move them in place of the pattern
+        free(tokens[i]);
+        memmove(tokens + i + matches.count, tokens + i + 1, (tokenCount - i - 1) * sizeof(char *));
+        memmove(quoted + i + matches.count, quoted + i + 1, (tokenCount - i - 1) * sizeof(int));
+        memcpy(tokens + i, matches.paths, matches.count * sizeof(char *));
+        for (int j = 0; j < matches.count; j++) {
+            quoted[i + j] = TOKEN_QUOTED; // File names are never expanded again
+        }
+        tokenCount += matches.count - 1;
+        i += matches.count - 1;
+        free(matches.paths);
+    }
+
+    tokens[tokenCount] = NULL;
+    return tokenCount;
+}